@@ -0,0 +1,36 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include <string>
+#include <vector>
+#include <map>
+#include <filesystem>
+
+// An assembly instruction, the inline comment is kept so the scheduled
+// program is still readable
+struct AsmInstr {
+    std::vector<std::string> parts; // name and operands, padded with "" to 4
+    std::string comment;
+};
+
+// Timing parameters from the workload's Config.txt
+struct MachineConfig {
+    std::map<std::string, int> params;
+    bool ooo = false; // issueMode = ooo
+
+    int get(const std::string& key, int default_value) const;
+};
+
+MachineConfig readConfig(const std::filesystem::path fp);
+std::vector<int32_t> readSdmem(const std::filesystem::path fp);
+
+// List schedules each basic block of the program against the timing model.
+// If unroll > 1, counted loops ending in a backward BNE are unrolled first,
+// their trip counts are found by running the scalar code over sdmem
+std::vector<AsmInstr> scheduleProgram(const std::vector<AsmInstr>& prog, const MachineConfig& config,
+                                      int unroll, const std::vector<int32_t>& sdmem);
+
+// Cycles the timing model gives a basic block (no branches into it) after
+// list scheduling it, used to compare code shapes
+long blockCycles(const std::vector<AsmInstr>& block, const MachineConfig& config);
+
+#endif
@@ -8,6 +8,9 @@ binary encoding of the assembly code
 #include <regex>
 #include <iostream>
 #include <map>
+#include <bitset>
+#include <filesystem>
+#include "scheduler.h"
 
 std::map<std::string, std::map<std::string, int>> op_map = {
     {
@@ -302,6 +305,36 @@ std::map<std::string, std::map<std::string, int>> op_map = {
             {"funct6", 0b001101}
         },
     },
+    {
+        "BARRIER", {
+            {"opcode", 0b000001}, 
+            {"funct6", 0b000001}
+        },
+    },
+    {
+        "MACW", {
+            {"opcode", 0b100000}, 
+            {"funct6", 0b001110}
+        },
+    },
+    {
+        "MTEW", {
+            {"opcode", 0b000011}, 
+            {"funct6", 0b000100}
+        },
+    },
+    {
+        "MFEW", {
+            {"opcode", 0b000100}, 
+            {"funct6", 0b000101}
+        },
+    },
+    {
+        "SVN", {
+            {"opcode", 0b101000}, 
+            {"funct6", 0b000000}
+        },
+    },
     {
         "HALT", {
             {"opcode", 0b111111}, 
@@ -361,6 +394,11 @@ std::map<std::string, std::string> instr_type_map = {
     {"UNPACKHI", "R"},
     {"PACKLO", "R"},
     {"PACKHI", "R"},
+    {"BARRIER", "R"},
+    {"MACW", "R"},
+    {"MTEW", "R"},
+    {"MFEW", "R"},
+    {"SVN", "R"},
     {"HALT", "R"},
 };
 
@@ -413,9 +451,9 @@ int get_reg_num(std::string& reg_str) {
 }
 
 int main(int argc, char* argv[]) {
-    // get filepath from argument
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <assembly_file>\n";
+    // get filepath and options from arguments
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <assembly_file> [--schedule <Config.txt>] [--unroll <N>]\n";
         return 1;
     }
 
@@ -423,6 +461,35 @@ int main(int argc, char* argv[]) {
     std::filesystem::path bin_fp = asm_fp;
     bin_fp.replace_extension(".bin");
 
+    std::filesystem::path config_fp;
+    int unroll = 1;
+
+    for (int i = 2; i < argc; i += 2) {
+        std::string opt = argv[i];
+        if (opt != "--schedule" && opt != "--unroll") {
+            std::cerr << "Unknown option: " << opt << "\n";
+            return 1;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << opt << "\n";
+            return 1;
+        }
+        if (opt == "--schedule")
+            config_fp = argv[i + 1];
+        else {
+            try {
+                unroll = std::stoi(argv[i + 1]);
+            }
+            catch (const std::exception&) {
+                unroll = 0;
+            }
+            if (unroll < 1) {
+                std::cerr << "--unroll must be a positive number, got " << argv[i + 1] << "\n";
+                return 1;
+            }
+        }
+    }
+
     std::ifstream asm_file(asm_fp);
     std::ofstream bin_file(bin_fp, std::ios::binary);
     
@@ -436,9 +503,7 @@ int main(int argc, char* argv[]) {
     std::string line;
     std::string trimmed_line;
     std::string comment_rmed;
-
-    // Define a 32-bit instruction
-    uint32_t encoded_instr = 0;
+    std::vector<AsmInstr> instrs;
 
     // Read the file line by line
     while (std::getline(asm_file, line)) {
@@ -448,8 +513,50 @@ int main(int argc, char* argv[]) {
         if (isCommentOrEmpty(trimmed_line))
             continue;
 
+        AsmInstr instr;
         comment_rmed = removeInlineComments(trimmed_line);
-        std::vector<std::string> parts = splitString(comment_rmed);
+        instr.parts = splitString(comment_rmed);
+        instr.parts.resize(4, ""); // missing operands are empty
+
+        size_t comment_start = trimmed_line.find('#');
+        if (comment_start != std::string::npos)
+            instr.comment = trim(trimmed_line.substr(comment_start + 1));
+
+        instrs.push_back(instr);
+    }
+
+    // Optional scheduling pass, the scheduled program is also saved as assembly
+    if (!config_fp.empty()) {
+        MachineConfig config = readConfig(config_fp);
+        std::vector<int32_t> sdmem;
+        if (unroll > 1)
+            sdmem = readSdmem(config_fp.parent_path() / "SDMEM.txt");
+
+        instrs = scheduleProgram(instrs, config, unroll, sdmem);
+
+        std::filesystem::path sched_fp = asm_fp;
+        sched_fp.replace_extension(".sched.asm");
+        std::ofstream sched_file(sched_fp);
+
+        if (!sched_file.is_open()) {
+            throw std::runtime_error("Error opening output file: " + sched_fp.string());
+        }
+
+        for (AsmInstr& instr : instrs) {
+            for (size_t i = 0; i < instr.parts.size() && !instr.parts[i].empty(); i++)
+                sched_file << (i ? " " : "") << instr.parts[i];
+            if (!instr.comment.empty())
+                sched_file << " # " << instr.comment;
+            sched_file << std::endl;
+        }
+        sched_file.close();
+    }
+
+    // Define a 32-bit instruction
+    uint32_t encoded_instr = 0;
+
+    for (AsmInstr& instr : instrs) {
+        std::vector<std::string>& parts = instr.parts;
 
         std::string instr_name = parts[0];
         std::string instr_type = instr_type_map[instr_name];
@@ -474,22 +581,24 @@ int main(int argc, char* argv[]) {
             int read_reg_2 = get_reg_num(parts[3]);
             int write_reg = get_reg_num(parts[1]);
             
-            // special case for S__VV, S__VS, and MTCL
-            if (instr_name.size() == 5 && instr_name.substr(0,1) == "S" && (instr_name.substr(3,2) == "VV" || instr_name.substr(3,2) == "VS")) {
+            // special case for S__VV, S__VS, MTCL and MTEW
+            std::string cond = instr_name.substr(1, 2);
+            bool is_compare = cond == "EQ" || cond == "NE" || cond == "GT" || cond == "LT" || cond == "GE" || cond == "LE";
+            if (instr_name.size() == 5 && instr_name.substr(0,1) == "S" && is_compare && (instr_name.substr(3,2) == "VV" || instr_name.substr(3,2) == "VS")) {
                 // Since, S__VV and S__VS write to vector mask register, there is no write register
                 // So, the first register is the read register 1 and the second register is the read register 2
                 read_reg_2 = read_reg_1;
                 read_reg_1 = write_reg;
                 write_reg = 0;
             }
-            else if (instr_name == "MTCL") {
-                // Since, MTCL writes to the vector length register, there is no write register
+            else if (instr_name == "MTCL" || instr_name == "MTEW") {
+                // Since, MTCL and MTEW write to the vector length register (and element width), there is no write register
                 // So, the first and only register is the read register 1 which is read from
                 read_reg_1 = write_reg;
                 write_reg = 0;
             }
 
-            encoded_instr = (opcode << 26) | (read_reg_1 << 20) | (read_reg_2 << 15) | (write_reg << 10) | (shift5 << 5) | (funct6 << 0);
+            encoded_instr = (opcode << 26) | (read_reg_1 << 21) | (read_reg_2 << 16) | (write_reg << 11) | (shift5 << 6) | (funct6 << 0);
 
             // Print binary representation and integer values of instruction fields
             std::cout << "Read reg 1 (5 bits): " << std::bitset<5>(read_reg_1) << " (" << read_reg_1 << ")" << std::endl;
@@ -508,7 +617,7 @@ int main(int argc, char* argv[]) {
             if (imm < 0) 
                 imm = imm & 0xFFFF;
 
-            encoded_instr = (opcode << 26) | (read_reg_1 << 20) | (write_reg << 15) | (imm << 0);
+            encoded_instr = (opcode << 26) | (read_reg_1 << 21) | (write_reg << 16) | (imm << 0);
 
             // Print binary representation and integer values of instruction fields
             std::cout << "Read reg 1 (5 bits): " << std::bitset<5>(read_reg_1) << " (" << read_reg_1 << ")" << std::endl;
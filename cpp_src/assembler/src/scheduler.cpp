@@ -0,0 +1,664 @@
+/*
+Latency aware instruction scheduler
+
+Builds a dependency DAG per basic block and list schedules it using the
+pipeline and queue depths of the timing simulator. Branch offsets are
+recomputed after scheduling, so blocks can also grow (loop unrolling).
+*/
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <deque>
+#include <set>
+#include "scheduler.h"
+
+const int MAX_VECTOR_LEN = 64;
+const int REG_COUNT = 8;
+const int REG_BITS = 32;
+const int SDMEM_SIZE = 1 << 13; // words, 32 KB
+const long MAX_PRE_EXEC_STEPS = 10000000;
+
+int MachineConfig::get(const std::string& key, int default_value) const {
+    auto it = params.find(key);
+    return it == params.end() ? default_value : it->second;
+}
+
+MachineConfig readConfig(const std::filesystem::path fp) {
+    std::ifstream file(fp);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Error opening file: " + fp.string());
+    }
+
+    MachineConfig config;
+    std::string line;
+
+    // lines are "key = value # comment"
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        if (eq == std::string::npos)
+            continue;
+
+        std::string key, value;
+        std::istringstream(line.substr(0, eq)) >> key;
+        std::istringstream(line.substr(eq + 1)) >> value;
+
+        if (key == "issueMode")
+            config.ooo = value == "ooo";
+        else if (!value.empty() && (std::isdigit(value[0]) || value[0] == '-'))
+            config.params[key] = std::stoi(value);
+    }
+
+    return config;
+}
+
+std::vector<int32_t> readSdmem(const std::filesystem::path fp) {
+    std::ifstream file(fp);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Error opening file: " + fp.string());
+    }
+
+    std::vector<int32_t> sdmem(SDMEM_SIZE, 0);
+    std::string line;
+    int addr = 0;
+
+    while (std::getline(file, line) && addr < SDMEM_SIZE) {
+        sdmem[addr++] = std::stoi(line);
+    }
+
+    return sdmem;
+}
+
+// ---- Instruction classes ----
+
+static bool isReg(const std::string& op) {
+    return op.size() > 2 && (op[0] == 'S' || op[0] == 'V') && op[1] == 'R';
+}
+
+static bool isBranch(const std::string& name) {
+    return name.size() == 3 && name[0] == 'B';
+}
+
+// instrs that end a basic block, nothing is moved across them
+static bool isBlockEnd(const std::string& name) {
+    return isBranch(name) || name == "HALT" || name == "BARRIER";
+}
+
+static bool isVecMem(const std::string& name) {
+    return name == "LV" || name == "SV" || name == "LVWS" || name == "SVWS" || name == "LVI" || name == "SVI" ||
+           name == "SVN";
+}
+
+static bool isVecStore(const std::string& name) {
+    return name == "SV" || name == "SVWS" || name == "SVI" || name == "SVN";
+}
+
+static bool isShuffle(const std::string& name) {
+    return name.find("PACK") != std::string::npos;
+}
+
+// S__VV and S__VS, which write the vector mask register
+static bool isMaskOp(const std::string& name) {
+    static const std::set<std::string> conds = {"EQ", "NE", "GT", "LT", "GE", "LE"};
+    return name.size() == 5 && name[0] == 'S' && conds.count(name.substr(1, 2)) &&
+           (name.substr(3, 2) == "VV" || name.substr(3, 2) == "VS");
+}
+
+static bool isVecCompute(const std::string& name) {
+    return isShuffle(name) || name == "MACW" ||
+           (name.size() == 5 && (name.substr(3, 2) == "VV" || name.substr(3, 2) == "VS"));
+}
+
+// functional unit, same split as the timing simulator
+static std::string unitOf(const std::string& name) {
+    if (isVecMem(name))
+        return "VLS";
+    if (isShuffle(name))
+        return "SHF";
+    if (isVecCompute(name)) {
+        if (name.substr(0, 3) == "MUL" || name == "MACW") return "MUL";
+        if (name.substr(0, 3) == "DIV") return "DIV";
+        return "ADD";
+    }
+    return "SCALAR";
+}
+
+static std::string queueOf(const std::string& name) {
+    if (isVecMem(name))
+        return "data";
+    if (isVecCompute(name))
+        return "compute";
+    return "scalar";
+}
+
+// Registers read and written by an instruction. VLR is the vector length
+// register and VMR the vector mask register. addrs are the scalar registers
+// only used to compute memory addresses, so they are free after issue
+struct RegUses {
+    std::vector<std::string> dsts, srcs, addrs;
+};
+
+static RegUses regUses(const AsmInstr& instr) {
+    const std::vector<std::string>& p = instr.parts;
+    const std::string& name = p[0];
+    RegUses uses;
+    std::vector<std::string> regs;
+
+    for (size_t i = 1; i < p.size(); i++) {
+        if (isReg(p[i]))
+            regs.push_back(p[i]);
+    }
+
+    if (isVecMem(name)) {
+        if (isVecStore(name))
+            uses.srcs.push_back(p[1]);
+        else
+            uses.dsts.push_back(p[1]);
+
+        for (size_t i = 2; i < p.size(); i++) {
+            if (!isReg(p[i])) continue;
+            uses.srcs.push_back(p[i]);
+            if (p[i][0] == 'S') uses.addrs.push_back(p[i]);
+        }
+        uses.srcs.insert(uses.srcs.end(), {"VLR", "VMR"});
+    }
+    else if (isMaskOp(name)) {
+        uses.dsts = {"VMR"};
+        uses.srcs = regs;
+        uses.srcs.push_back("VLR");
+    }
+    else if (isVecCompute(name)) {
+        uses.dsts = {regs[0]};
+        // MACW accumulates into its dst
+        uses.srcs.assign(regs.begin() + (name == "MACW" ? 0 : 1), regs.end());
+        uses.srcs.push_back("VLR");
+        if (!isShuffle(name)) uses.srcs.push_back("VMR");
+    }
+    else if (name == "CVM") {
+        uses.dsts = {"VMR"};
+    }
+    else if (name == "POP") {
+        uses.dsts = regs;
+        uses.srcs = {"VMR"};
+    }
+    else if (name == "MTCL" || name == "MTEW") { // MTEW also sets the vector length
+        uses.dsts = {"VLR"};
+        uses.srcs = regs;
+    }
+    else if (name == "MFCL" || name == "MFEW") {
+        uses.dsts = regs;
+        uses.srcs = {"VLR"};
+    }
+    else if (name == "LS") {
+        uses.dsts = {p[1]};
+        uses.srcs = uses.addrs = {p[2]};
+    }
+    else if (name == "SS") {
+        uses.srcs = {p[1], p[2]};
+        uses.addrs = {p[2]};
+    }
+    else if (isBranch(name)) {
+        uses.srcs = regs;
+    }
+    else if (!regs.empty()) { // scalar alu ops
+        uses.dsts = {regs[0]};
+        uses.srcs.assign(regs.begin() + 1, regs.end());
+    }
+
+    return uses;
+}
+
+static bool intersects(const std::vector<std::string>& a, const std::vector<std::string>& b) {
+    for (const std::string& x : a) {
+        if (std::find(b.begin(), b.end(), x) != b.end())
+            return true;
+    }
+    return false;
+}
+
+// ---- Timing model ----
+// A cheap model of the timing simulator: one instruction decoded per cycle,
+// in order issue stalls on any busy operand (busy board), FIFO dispatch
+// queues, and each unit runs one instruction at a time.
+// With issueMode = ooo only true dependencies and the units are modelled.
+
+class TimingModel {
+private:
+    const MachineConfig& config;
+    long lastDecode = 0;
+    std::map<std::string, long> regFree, unitFree, lastStart;
+    std::map<std::string, std::deque<long>> queueStarts;
+
+    long at(const std::map<std::string, long>& m, const std::string& key) const {
+        auto it = m.find(key);
+        return it == m.end() ? 0 : it->second;
+    }
+
+    int queueDepth(const std::string& queue) const {
+        if (queue == "data") return config.get("dataQueueDepth", 4);
+        if (queue == "compute") return config.get("computeQueueDepth", 4);
+        return 1;
+    }
+
+public:
+    long makespan = 0;
+
+    TimingModel(const MachineConfig& config) : config(config) {}
+
+    int latency(const AsmInstr& instr) const {
+        std::string unit = unitOf(instr.parts[0]);
+        int lanes = config.get("numLanes", 4);
+        int vec_cycles = (MAX_VECTOR_LEN + lanes - 1) / lanes;
+
+        if (unit == "VLS") return config.get("vlsPipelineDepth", 11) + vec_cycles;
+        if (unit == "ADD") return config.get("pipelineDepthAdd", 2) + vec_cycles;
+        if (unit == "MUL") return config.get("pipelineDepthMul", 12) + vec_cycles;
+        if (unit == "DIV") return config.get("pipelineDepthDiv", 8) + vec_cycles;
+        if (unit == "SHF") return config.get("pipelineDepthShuffle", 5) + vec_cycles;
+        return 1;
+    }
+
+    // returns the decode and start cycle instr would get if it went next
+    void peek(const AsmInstr& instr, long& decode, long& start) const {
+        RegUses uses = regUses(instr);
+        std::string unit = unitOf(instr.parts[0]);
+        std::string queue = queueOf(instr.parts[0]);
+
+        decode = lastDecode + 1;
+        start = std::max(at(unitFree, unit), at(lastStart, queue));
+
+        if (config.ooo) {
+            for (const std::string& r : uses.srcs)
+                start = std::max(start, at(regFree, r));
+        }
+        else {
+            for (const std::string& r : uses.srcs)
+                decode = std::max(decode, at(regFree, r));
+            for (const std::string& r : uses.dsts)
+                decode = std::max(decode, at(regFree, r));
+
+            // wait for a free slot in the queue
+            auto it = queueStarts.find(queue);
+            int depth = queueDepth(queue);
+            if (it != queueStarts.end() && (int)it->second.size() >= depth)
+                decode = std::max(decode, it->second[it->second.size() - depth]);
+        }
+
+        start = std::max(start, decode + 1);
+    }
+
+    void place(const AsmInstr& instr) {
+        long decode, start;
+        peek(instr, decode, start);
+
+        RegUses uses = regUses(instr);
+        std::string unit = unitOf(instr.parts[0]);
+        std::string queue = queueOf(instr.parts[0]);
+        long done = start + latency(instr);
+
+        lastDecode = decode;
+        unitFree[unit] = done;
+        lastStart[queue] = start;
+        queueStarts[queue].push_back(start);
+        if ((int)queueStarts[queue].size() > queueDepth(queue))
+            queueStarts[queue].pop_front();
+
+        if (config.ooo) {
+            for (const std::string& r : uses.dsts)
+                regFree[r] = done;
+        }
+        else {
+            // the busy board holds every operand until the instr is done,
+            // except address regs which are read when the instr starts.
+            // Reading VLR or VMR doesn't hold them, they aren't operands
+            for (const std::string& r : uses.srcs) {
+                if (r == "VLR" || r == "VMR")
+                    continue;
+                bool is_addr = std::find(uses.addrs.begin(), uses.addrs.end(), r) != uses.addrs.end();
+                regFree[r] = std::max(regFree[r], is_addr ? start + 1 : done);
+            }
+            for (const std::string& r : uses.dsts)
+                regFree[r] = std::max(regFree[r], done);
+        }
+
+        makespan = std::max(makespan, done);
+    }
+};
+
+static long modelCycles(const std::vector<AsmInstr>& block, const MachineConfig& config) {
+    TimingModel model(config);
+    for (const AsmInstr& instr : block)
+        model.place(instr);
+    return model.makespan;
+}
+
+// ---- List scheduling ----
+
+// Schedules a basic block, the last instr stays last if it is a branch, HALT or BARRIER
+static std::vector<AsmInstr> scheduleBlock(const std::vector<AsmInstr>& block, const MachineConfig& config) {
+    int n = (int)block.size();
+    const std::string& last = block.back().parts[0];
+    if (isBlockEnd(last))
+        n--;
+
+    if (n < 2)
+        return block;
+
+    TimingModel model(config);
+    std::vector<RegUses> uses;
+    for (int i = 0; i < n; i++)
+        uses.push_back(regUses(block[i]));
+
+    // dependency DAG, edge weight is the cycles the successor has to wait
+    std::vector<std::vector<std::pair<int, int>>> succs(n);
+    std::vector<int> num_preds(n, 0);
+
+    for (int i = 0; i < n; i++) {
+        const std::string& a = block[i].parts[0];
+        bool a_sdmem = a == "LS" || a == "SS", a_vdmem = isVecMem(a);
+        bool a_store = a == "SS" || isVecStore(a);
+
+        for (int j = i + 1; j < n; j++) {
+            const std::string& b = block[j].parts[0];
+            bool b_store = b == "SS" || isVecStore(b);
+            bool same_mem = (a_sdmem && (b == "LS" || b == "SS")) || (a_vdmem && isVecMem(b));
+
+            bool raw = intersects(uses[i].dsts, uses[j].srcs);
+            bool war = intersects(uses[i].srcs, uses[j].dsts);
+            bool waw = intersects(uses[i].dsts, uses[j].dsts);
+            bool mem = same_mem && (a_store || b_store);
+
+            if (!(raw || war || waw || mem))
+                continue;
+
+            int weight = (raw || mem || !config.ooo) ? model.latency(block[i]) : 0;
+            succs[i].push_back({j, weight});
+            num_preds[j]++;
+        }
+    }
+
+    // priority is the longest weighted path to the end of the block
+    std::vector<long> priority(n, 0);
+    for (int i = n - 1; i >= 0; i--) {
+        priority[i] = model.latency(block[i]);
+        for (auto& [j, weight] : succs[i])
+            priority[i] = std::max(priority[i], weight + priority[j]);
+    }
+
+    std::vector<AsmInstr> scheduled;
+    std::vector<bool> done(n, false);
+
+    for (int k = 0; k < n; k++) {
+        // pick the ready instr that decodes earliest, then highest priority
+        int best = -1;
+        long best_decode = 0;
+
+        for (int i = 0; i < n; i++) {
+            if (done[i] || num_preds[i] > 0)
+                continue;
+
+            long decode, start;
+            model.peek(block[i], decode, start);
+
+            if (best == -1 || decode < best_decode || (decode == best_decode && priority[i] > priority[best])) {
+                best = i;
+                best_decode = decode;
+            }
+        }
+
+        done[best] = true;
+        model.place(block[best]);
+        scheduled.push_back(block[best]);
+
+        for (auto& [j, weight] : succs[best])
+            num_preds[j]--;
+    }
+
+    scheduled.insert(scheduled.end(), block.begin() + n, block.end());
+
+    // only keep the new order if the model says it is faster
+    if (modelCycles(scheduled, config) > modelCycles(block, config))
+        return block;
+
+    return scheduled;
+}
+
+// ---- Loop unrolling ----
+
+static bool condTaken(const std::string& name, int64_t a, int64_t b) {
+    if (name == "BEQ") return a == b;
+    if (name == "BNE") return a != b;
+    if (name == "BGT") return a > b;
+    if (name == "BLT") return a < b;
+    if (name == "BGE") return a >= b;
+    return a <= b; // BLE
+}
+
+// Runs only the scalar part of the program, which decides the control flow
+// as long as there are no S__VV/S__VS (POP is then always the max vector length).
+// Returns the trip count of each entry into each backward BNE loop, keyed by
+// the branch index, or false if the control flow can't be found this way
+static bool tripCounts(const std::vector<AsmInstr>& prog, std::vector<int32_t> sdmem,
+                       std::map<int, std::vector<long>>& counts) {
+    std::map<int, int> headers; // loop header -> branch index
+    for (int i = 0; i < (int)prog.size(); i++) {
+        const std::string& name = prog[i].parts[0];
+        // the other cores' writes between barriers can't be pre-executed here
+        if (isMaskOp(name) || name == "BARRIER")
+            return false;
+        if (name == "BNE" && std::stoi(prog[i].parts[3]) < 0)
+            headers[i + std::stoi(prog[i].parts[3])] = i;
+    }
+
+    int64_t sr[REG_COUNT] = {0};
+    int64_t vlen = MAX_VECTOR_LEN;
+    int64_t ew = REG_BITS; // element width
+    int pc = 0, prev_pc = -1;
+    long steps = 0;
+
+    auto reg = [](const std::string& op) { return std::stoi(op.substr(2)); };
+    auto write = [&](const std::string& op, int64_t value) { if (reg(op) != 0) sr[reg(op)] = value; };
+
+    while (pc >= 0 && pc < (int)prog.size() && prog[pc].parts[0] != "HALT") {
+        if (++steps > MAX_PRE_EXEC_STEPS)
+            return false;
+
+        auto header = headers.find(pc);
+        if (header != headers.end() && prev_pc != header->second)
+            counts[header->second].push_back(0);
+
+        const std::vector<std::string>& p = prog[pc].parts;
+        const std::string& name = p[0];
+        int next_pc = pc + 1;
+
+        if (name == "LS" || name == "SS") {
+            int64_t addr = sr[reg(p[2])] + std::stoi(p[3]);
+            if (addr < 0 || addr >= SDMEM_SIZE)
+                return false;
+            if (name == "LS")
+                write(p[1], sdmem[addr]);
+            else
+                sdmem[addr] = (int32_t)sr[reg(p[1])];
+        }
+        else if (isBranch(name)) {
+            if (name == "BNE" && counts.count(pc))
+                counts[pc].back()++;
+            if (condTaken(name, sr[reg(p[1])], sr[reg(p[2])]))
+                next_pc = pc + std::stoi(p[3]);
+        }
+        else if (name == "MTCL") vlen = sr[reg(p[1])];
+        else if (name == "MFCL") write(p[1], vlen);
+        else if (name == "MTEW") {
+            ew = sr[reg(p[1])];
+            if (ew != 8 && ew != 16 && ew != 32)
+                return false;
+            vlen = MAX_VECTOR_LEN * REG_BITS / ew;
+        }
+        else if (name == "MFEW") write(p[1], ew);
+        else if (name == "POP") write(p[1], MAX_VECTOR_LEN * REG_BITS / ew);
+        else if (isReg(p[1]) && p[1][0] == 'S' && isReg(p[2]) && isReg(p[3])) {
+            // scalar alu ops, same semantics as the functional simulator
+            int64_t x = sr[reg(p[2])], y = sr[reg(p[3])];
+            if (name == "ADD") write(p[1], x + y);
+            else if (name == "SUB") write(p[1], x - y);
+            else if (name == "MUL") write(p[1], x * y);
+            else if (name == "DIV") {
+                if (y == 0) return false;
+                int64_t q = x / y;
+                write(p[1], (q * y != x && (x < 0) != (y < 0)) ? q - 1 : q); // floor division
+            }
+            else if (name == "AND") write(p[1], x & y);
+            else if (name == "OR") write(p[1], x | y);
+            else if (name == "XOR") write(p[1], x ^ y);
+            // shift amounts use the low 5 bits, like the functional simulator
+            else if (name == "SLL") write(p[1], int32_t(uint32_t(x) << (y & 31)));
+            else if (name == "SRL") write(p[1], int32_t(uint32_t(x) >> (y & 31)));
+            else if (name == "SRA") write(p[1], int32_t(x) >> (y & 31));
+        }
+
+        prev_pc = pc;
+        pc = next_pc;
+    }
+
+    return true;
+}
+
+// Unrolls a loop block (body + backward BNE to its start) by unroll times.
+// Vector regs that are written before being read in the body are renamed
+// in all but the last copy, using vector regs the program never touches,
+// so the copies don't have to wait on each other.
+static std::vector<AsmInstr> unrollBlock(const std::vector<AsmInstr>& block, int unroll,
+                                         const std::vector<AsmInstr>& prog) {
+    std::vector<AsmInstr> body(block.begin(), block.end() - 1);
+
+    std::set<std::string> used;
+    for (const AsmInstr& instr : prog) {
+        for (size_t i = 1; i < instr.parts.size(); i++)
+            used.insert(instr.parts[i]);
+    }
+
+    std::vector<std::string> scratch;
+    for (int i = 1; i < REG_COUNT; i++) {
+        std::string reg = "VR" + std::to_string(i);
+        if (!used.count(reg))
+            scratch.push_back(reg);
+    }
+
+    // only safe when the vector length is the same for the whole body
+    std::vector<std::string> temps;
+    std::set<std::string> seen;
+    bool sets_vlen = false;
+    for (const AsmInstr& instr : body) {
+        RegUses uses = regUses(instr);
+        sets_vlen |= instr.parts[0] == "MTCL" || instr.parts[0] == "MTEW";
+
+        for (const std::string& r : uses.srcs)
+            seen.insert(r);
+        for (const std::string& r : uses.dsts) {
+            if (r[0] == 'V' && r != "VMR" && !seen.count(r))
+                temps.push_back(r);
+            seen.insert(r);
+        }
+    }
+    if (sets_vlen)
+        temps.clear();
+
+    // reg sets, the last copy always uses the original regs
+    std::vector<std::map<std::string, std::string>> sets(1);
+    for (size_t i = 0; i < scratch.size() && !temps.empty(); i += temps.size()) {
+        std::map<std::string, std::string> rename;
+        for (size_t j = 0; j < temps.size() && i + j < scratch.size(); j++)
+            rename[temps[j]] = scratch[i + j];
+        sets.push_back(rename);
+    }
+
+    std::vector<AsmInstr> unrolled;
+    for (int copy = 0; copy < unroll; copy++) {
+        const std::map<std::string, std::string>& rename = sets[(unroll - 1 - copy) % sets.size()];
+        for (AsmInstr instr : body) {
+            for (size_t i = 1; i < instr.parts.size(); i++) {
+                auto it = rename.find(instr.parts[i]);
+                if (it != rename.end())
+                    instr.parts[i] = it->second;
+            }
+            unrolled.push_back(instr);
+        }
+    }
+
+    unrolled.push_back(block.back());
+    return unrolled;
+}
+
+long blockCycles(const std::vector<AsmInstr>& block, const MachineConfig& config) {
+    return modelCycles(scheduleBlock(block, config), config);
+}
+
+// ---- Program ----
+
+std::vector<AsmInstr> scheduleProgram(const std::vector<AsmInstr>& prog, const MachineConfig& config,
+                                      int unroll, const std::vector<int32_t>& sdmem) {
+    int n = (int)prog.size();
+
+    // branch targets as absolute indexes into the original program
+    std::vector<int> targets(n, -1);
+    std::set<int> leaders = {0};
+
+    for (int i = 0; i < n; i++) {
+        const std::string& name = prog[i].parts[0];
+        if (isBranch(name)) {
+            targets[i] = i + std::stoi(prog[i].parts[3]);
+            if (targets[i] >= 0 && targets[i] <= n)
+                leaders.insert(targets[i]);
+        }
+        if (isBlockEnd(name))
+            leaders.insert(i + 1);
+    }
+
+    std::map<int, std::vector<long>> counts;
+    bool unrollable = unroll > 1 && tripCounts(prog, sdmem, counts);
+
+    // split into basic blocks, then unroll and schedule each one
+    std::vector<AsmInstr> result;
+    std::vector<int> branch_pos, branch_target; // position in result, original target
+    std::map<int, int> new_start;               // original leader -> position in result
+
+    for (auto it = leaders.begin(); it != leaders.end() && *it < n; it++) {
+        int start = *it;
+        int end = std::next(it) == leaders.end() ? n : std::min(*std::next(it), n);
+        int last = end - 1;
+
+        std::vector<AsmInstr> block(prog.begin() + start, prog.begin() + end);
+
+        // a loop that is a single block, every entry runs a multiple of unroll iterations
+        bool is_loop = prog[last].parts[0] == "BNE" && targets[last] == start && last > start;
+        if (unrollable && is_loop && counts.count(last)) {
+            bool divisible = true;
+            for (long count : counts[last])
+                divisible &= count > 0 && count % unroll == 0;
+            if (divisible)
+                block = unrollBlock(block, unroll, prog);
+        }
+
+        block = scheduleBlock(block, config);
+
+        new_start[start] = (int)result.size();
+        if (targets[last] != -1) {
+            branch_pos.push_back((int)result.size() + (int)block.size() - 1);
+            branch_target.push_back(targets[last]);
+        }
+        result.insert(result.end(), block.begin(), block.end());
+    }
+    new_start[n] = (int)result.size();
+
+    // fix branch offsets for the new positions
+    for (size_t i = 0; i < branch_pos.size(); i++) {
+        auto it = new_start.find(branch_target[i]);
+        if (it != new_start.end())
+            result[branch_pos[i]].parts[3] = std::to_string(it->second - branch_pos[i]);
+    }
+
+    return result;
+}
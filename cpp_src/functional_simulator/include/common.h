@@ -5,14 +5,15 @@
 #include <filesystem>
 
 enum OPERAND_TYPE {VECTOR, SCALAR, IMM};
-enum INSTRUCTION {PACKLO, SUBVV, MULVV, ADDVV, PACKHI, UNPACKHI, UNPACKLO, DIVVV, DIVVS, MULVS, SUBVS, ADDVS, SLEVV, SGTVV, SEQVV, SLTVV, SGEVV, SNEVV, SGTVS, SLEVS, LV, SNEVS, SLTVS, SEQVS, SV, SGEVS, POP, MFCL, MTCL, SVWS, LVWS, LVI, SVI, BGT, BLE, BLT, LS, BGE, BNE, SS, BEQ, SUB, OR, AND, SRA, ADD, SRL, SLL, XOR, CVM, HALT};
+enum INSTRUCTION {PACKLO, SUBVV, MULVV, ADDVV, PACKHI, UNPACKHI, UNPACKLO, DIVVV, DIVVS, MULVS, SUBVS, ADDVS, SLEVV, SGTVV, SEQVV, SLTVV, SGEVV, SNEVV, SGTVS, SLEVS, LV, SNEVS, SLTVS, SEQVS, SV, SGEVS, POP, MFCL, MTCL, SVWS, LVWS, LVI, SVI, BGT, BLE, BLT, LS, BGE, BNE, SS, BEQ, SUB, OR, AND, SRA, ADD, SRL, SLL, XOR, CVM, HALT, BARRIER, MACW, MTEW, MFEW, SVN};
 
 struct Operand {
-    REG_TYPE reg_type;
-    int idx;
-}
+    OPERAND_TYPE type = IMM;
+    int value = 0; // register number or immediate
+};
 
 struct Instruction {
+    INSTRUCTION op;
     std::string name;
     Operand op1;
     Operand op2;
@@ -23,16 +24,19 @@ struct Instruction {
 // Note: All data is 32 bit (except vector mask reg)
 
 // Memory is word addressable
-const int VDMEM_SIZE = 128000; // 512 KB -> 4096000 bits / 32 bit = 128000 words
-const int SDMEM_SIZE = 8000; // 32 KB -> 256000 bits / 32 bit = 8000 words
+const int VDMEM_SIZE = 1 << 17; // 512 KB / 4 bytes per word = 131072 words, same as the Python simulator
+const int SDMEM_SIZE = 1 << 13; // 32 KB / 4 bytes per word = 8192 words
+
+const int REG_BITS = 32;
+const int MAX_VECTOR_LEN = 64;
+const int MAX_LANES = 256; // elements in a vector register at 8 bit elements, one mask bit each
 
 const int SREG_SHAPE[2] = {8, 1};
-const int VREG_SHAPE[2] = {8, 64};
-const int VLEN_REG_SHAPE[2] = {1, 1};
-const int VMASK_REG_SHAPE[2] = {1, 64};
+const int VREG_SHAPE[2] = {8, MAX_VECTOR_LEN};
 
 // Filenames
 const std::filesystem::path ASM_CODE_FN = "Code.asm";
+const std::filesystem::path BIN_CODE_FN = "Code.bin";
 
 const std::filesystem::path SDMEM_FN = "SDMEM.txt";
 const std::filesystem::path VDMEM_FN = "VDMEM.txt";
@@ -40,6 +44,9 @@ const std::filesystem::path VDMEM_FN = "VDMEM.txt";
 const std::filesystem::path SDMEM_OP_FN = "SDMEMOP.txt";
 const std::filesystem::path VDMEM_OP_FN = "VDMEMOP.txt";
 
+const std::filesystem::path SDMEM_DELTA_FN = "SDMEMOP.delta.txt";
+const std::filesystem::path VDMEM_DELTA_FN = "VDMEMOP.delta.txt";
+
 const std::filesystem::path VRF_OP_FN = "VRF.txt";
 const std::filesystem::path SRF_OP_FN = "SRF.txt";
 
@@ -1,22 +1,82 @@
 #ifndef CORE_H
 #define CORE_H
 #include <string>
+#include <vector>
+#include <cstdint>
+#include "common.h"
 #include "memory.h"
 #include "register.h"
 
+// Runs a program one instr at a time, with the same results as the Python
+// functional simulator. In both, scalar and vector values wrap around at 32 bits
+// (or at the element width), shift amounts use their low 5 bits, and SR0/VR0
+// always read 0.
 class FunctionalSimulator {
 private:
     Memory SDMEM, VDMEM;
-    Register SREG, VREG, VMASK_REG;
+    Register SREG, VREG;
+    std::vector<uint8_t> VMASK; // one per element, MAX_LANES
+    std::vector<Instruction> program;
+    int pc = 0;
+    int vlen = MAX_VECTOR_LEN;
+    int ew = REG_BITS; // element width, set with MTEW
+    bool halted = false;
+    uint64_t instr_count = 0;
+
+    // unpacked elements of the operands, MAX_LANES each
+    std::vector<int32_t> elems1, elems2, elems3;
+
+    void resetCore();
+    int lanesPerWord() const;
+    int32_t readSreg(const Operand& op) const;
+    void writeSreg(const Operand& op, int32_t value);
+    void readVec(const Operand& op, int32_t* elems) const;
+    void writeVec(const Operand& op, const int32_t* elems);
+    // addr is an element addr, word addr * lanesPerWord() + lane
+    int32_t readElem(int64_t addr) const;
+    void writeElem(int64_t addr, int32_t value);
+
+    void execute(const Instruction& instr);
+    void scalarOp(const Instruction& instr);
+    void vectorOp(const Instruction& instr);
+    void compare(const Instruction& instr);
+    void loadVec(const Instruction& instr);
+    void storeVec(const Instruction& instr);
+    void shuffle(const Instruction& instr);
+    void macw(const Instruction& instr);
+    void svn(const Instruction& instr);
 public:
-    FunctionalSimulator(const std::filesystem::path iodir);
-    void run();
-    void IF();
-    void ID();
-    void EX();
-    void MEM();
-    void WB();
+    // empty program, all zero memories
+    FunctionalSimulator();
+    // Code.asm (or Code.bin if use_bin), SDMEM.txt and VDMEM.txt from iodir
+    FunctionalSimulator(const std::filesystem::path iodir, bool use_bin = false);
+
+    // replaces the program and resets the registers and PC, memory is kept
+    void loadProgram(const std::vector<Instruction>& instrs);
+    // registers, PC, vector length, element width and mask back to the start,
+    // memories back to their input image
+    void reset();
+    // runs one instr, false once HALT has run
+    bool step();
+    // runs to HALT, or max_instrs instrs if not 0, returns the instrs run
+    uint64_t run(uint64_t max_instrs = 0);
+
+    bool isHalted() const;
+    int getPc() const;
+    int getVlen() const;
+    int getEw() const;
+    // max vector len at the current element width
+    int mvl() const;
+    uint64_t getInstrCount() const;
+    const uint8_t* vectorMask() const;
+    Memory& sdmem();
+    Memory& vdmem();
+    Register& sreg();
+    Register& vreg();
+    const Register& sreg() const;
+    const Register& vreg() const;
 
+    void dumpRegs(const std::filesystem::path iodir) const;
 };
 
 #endif
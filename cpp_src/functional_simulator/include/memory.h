@@ -1,17 +1,56 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 #include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <filesystem>
 
+// Paged word addressable memory. Pages keep the input image until their first
+// write, when they get a copy of their own. Pages past the end of the input
+// file all point at one shared zero page, so they are never allocated unless written.
+//
+// The input image can also be a caller-owned array, which is never written,
+// so many simulators can share it. Or the whole memory can be mapped onto a
+// caller-owned buffer that is read and written in place.
 class Memory {
 private:
-    int32_t* data;
-    int size;
+    static constexpr int PAGE_BITS = 10; // 1024 words per page
+    static constexpr int PAGE_SIZE = 1 << PAGE_BITS;
+    static const int32_t ZERO_PAGE[PAGE_SIZE];
+
+    int capacity;                                        // words in the memory
+    int size;                                            // addressable words, less when a short buffer is mapped
+    int32_t* buffer = nullptr;                           // mapped caller buffer, nullptr when paged
+    std::vector<std::unique_ptr<int32_t[]>> base_pages;  // input image pages read from a file
+    std::vector<const int32_t*> image_pages;             // input image of each page
+    std::vector<std::unique_ptr<int32_t[]>> dirty_pages; // nullptr until the page is written
+    std::vector<const int32_t*> pages;                   // current contents of each page
+
+    void checkAddr(int32_t addr) const;
+    void clearImage();
 public:
+    // all zero
+    Memory(int size);
     Memory(const std::filesystem::path fp, int size);
-    int32_t read(int32_t addr);
+    // input image from a file, one word per line
+    void load(const std::filesystem::path fp);
+    // input image from image[0, n_words), which must outlive the memory or the next load
+    void loadImage(const int32_t* image, int n_words);
+    // read and write buffer[0, n_words) in place, addresses past it are out of range
+    void mapBuffer(int32_t* buffer, int n_words);
+    // back to the input image, a mapped buffer is left as it is
+    void reset();
+    int32_t read(int32_t addr) const;
     void write(int32_t addr, int32_t value);
-    void dump(const std::filesystem::path fp);
-    ~Memory();
+    int getSize() const;
+    // every word, one per line
+    void dump(const std::filesystem::path fp) const;
+    // only the words that differ from the input image, each run of them
+    // starts with an "@ <addr>" line. Same format as the Python simulator, the
+    // header names the memory, e.g. "# VDMEM changes from VDMEM.txt, 131072 words"
+    void dumpDelta(const std::filesystem::path fp, const std::string& name) const;
+    int dirtyPageCount() const;
 };
 
 #endif
@@ -0,0 +1,43 @@
+#ifndef PACKED_H
+#define PACKED_H
+#include <cstdint>
+
+// Packed int8/int16 elements. With element width ew < 32, each 32 bit word of
+// a vector register or VDMEM holds 32 / ew elements, element 0 in the low bits.
+// Elements are signed and wrap around on overflow, same as the Python simulator.
+// The ops work on unpacked elements, one int32_t each, in 32 bit lanes with
+// branchless masking and clamping, so the compiler vectorizes them. They run
+// to their element count rounded up to PACKED_BLOCK, so the arrays passed in
+// need that much room (MAX_LANES elements, or a whole vector register, is
+// always enough) and must not overlap.
+
+const int ELEMENT_WIDTHS[3] = {8, 16, 32};
+const int PACKED_BLOCK = 16;
+
+bool validElementWidth(int ew);
+
+// two's complement wrap around / clamp of val to a signed ew bit int
+int32_t wrapElem(int64_t val, int ew);
+int32_t saturateElem(int64_t val, int ew);
+
+int32_t getElem(int32_t word, int lane, int ew);
+int32_t setElem(int32_t word, int lane, int32_t val, int ew);
+
+// words <-> elements, elems has n_words * 32 / ew entries
+void unpackWords(const int32_t* words, int n_words, int ew, int32_t* elems);
+void packWords(const int32_t* elems, int n_words, int ew, int32_t* words);
+
+// dst[i] = a[i] op b[i] for the first n elements, the rest of dst is kept.
+// mask has one entry per element, 0 keeps the old element
+enum PackedOp {PACKED_ADD, PACKED_SUB, PACKED_MUL};
+void packedOp(PackedOp op, const int32_t* a, const int32_t* b, int32_t* dst, int n, int ew, const uint8_t* mask);
+
+// widening multiply accumulate (MACW), acc[j] += sum of a[i] * b[i] for the
+// elements i < n in word j, acc has 32 bit elements
+void packedMacw(const int32_t* a, const int32_t* b, int32_t* acc, int n, int ew, const uint8_t* mask);
+
+// saturating narrow (SVN), packs ceil(n / (32 / ew)) 32 bit elements of src into
+// ew bit elements, returns the number of elements written to dst_elems
+int packedNarrow(const int32_t* src, int n, int ew, int32_t* dst_elems, const uint8_t* mask);
+
+#endif
@@ -2,10 +2,21 @@
 #define PARSE_ASM_H
 #include <string>
 #include <vector>
+#include <cstdint>
 #include "common.h"
 
 bool isCommentOrEmpty(std::string& line);
 Instruction str2Struct(std::string& line);
 std::vector<Instruction> parseAsm(const std::filesystem::path fp);
+// assembly code held in memory, same format as Code.asm
+std::vector<Instruction> parseAsmString(const std::string& code);
+
+// Code.bin from the assembler, one 32 bit word per instr:
+// R-type opcode (6) | rs (5) | rt (5) | rd (5) | shift (5) | funct (6)
+// I-type opcode (6) | rs (5) | rt (5) | imm (16)
+// register fields are 1VVVV for VRs and 0SSSS for SRs
+Instruction decodeInstr(uint32_t word);
+std::vector<Instruction> decodeBin(const uint32_t* words, size_t n);
+std::vector<Instruction> parseBin(const std::filesystem::path fp);
 
 #endif
@@ -1,17 +1,26 @@
 #ifndef REGISTER_H
 #define REGISTER_H
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
 
+// shape[0] registers of shape[1] words each, all zero at the start
 class Register {
 private:
-    int32_t** data;
+    std::vector<int32_t> data;
     int shape[2];
 public:
     Register(const int shape[2]);
-    int32_t read(int reg_num, int idx);
+    int32_t read(int reg_num, int idx) const;
     void write(int reg_num, int idx, int32_t value);
-    void dump(const std::filesystem::path fp);
-    ~Register();
+    // the shape[1] words of a register
+    const int32_t* row(int reg_num) const;
+    int32_t* row(int reg_num);
+    int count() const;
+    void reset();
+    // one line per register, same as the Python simulator
+    void dump(const std::filesystem::path fp) const;
 };
 
 #endif
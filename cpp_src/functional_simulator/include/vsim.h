@@ -0,0 +1,103 @@
+#ifndef VSIM_H
+#define VSIM_H
+/*
+C API of the functional simulator, built as libvsim.a and libvsim.so.
+
+    vsim* sim = vsim_create();
+    vsim_load_asm_file(sim, "dot_product/Code.asm");
+    vsim_map_mem_image(sim, VSIM_VDMEM, inputs, n_words);
+    for (...) {
+        vsim_reset(sim);
+        vsim_write_sreg(sim, 1, param);
+        vsim_run(sim, 0);
+        vsim_read_mem(sim, VSIM_VDMEM, out_addr, out, n_out);
+    }
+    vsim_destroy(sim);
+
+Functions that can fail return VSIM_OK or VSIM_ERROR, and vsim_last_error has
+the message. A simulator must only be used by one thread at a time, separate
+simulators can run on separate threads.
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vsim vsim;
+
+enum vsim_status {
+    VSIM_ERROR = -1,
+    VSIM_OK = 0,
+    VSIM_HALTED = 1,   // HALT has run
+    VSIM_RUNNING = 2,  // vsim_run stopped at max_instrs before HALT
+};
+
+enum vsim_mem {
+    VSIM_SDMEM = 0,
+    VSIM_VDMEM = 1,
+};
+
+// NULL if the simulator couldn't be allocated
+vsim* vsim_create(void);
+void vsim_destroy(vsim* sim);
+// message of the last VSIM_ERROR, "" if there was none
+const char* vsim_last_error(const vsim* sim);
+
+// Programs. Loading one resets the registers and PC, memory is kept
+int vsim_load_asm_file(vsim* sim, const char* path);
+int vsim_load_bin_file(vsim* sim, const char* path);
+// text in the Code.asm format
+int vsim_load_asm(vsim* sim, const char* code);
+// words in the Code.bin format
+int vsim_load_bin(vsim* sim, const uint32_t* words, size_t n_words);
+
+// Memory. Each memory starts all zero and takes one of:
+// - a file in the SDMEM.txt/VDMEM.txt format
+// - an image of n_words, which is only read, so several simulators can share
+//   it. Written pages get a private copy that vsim_reset drops. The image must
+//   stay alive until the memory is loaded again or the simulator is destroyed
+// - a buffer of n_words that is read and written in place, addresses past it
+//   are out of range. vsim_reset leaves it as it is
+int vsim_load_mem_file(vsim* sim, int mem, const char* path);
+int vsim_map_mem_image(vsim* sim, int mem, const int32_t* image, size_t n_words);
+int vsim_map_mem(vsim* sim, int mem, int32_t* buffer, size_t n_words);
+// copy n words from/to addr
+int vsim_read_mem(vsim* sim, int mem, int32_t addr, int32_t* out, size_t n);
+int vsim_write_mem(vsim* sim, int mem, int32_t addr, const int32_t* values, size_t n);
+// words in the memory, or in its mapped buffer, 0 if mem is unknown
+size_t vsim_mem_size(vsim* sim, int mem);
+
+// Execution
+// registers, PC, vector length, element width and mask back to the start,
+// and memories back to their image
+void vsim_reset(vsim* sim);
+// one instr, VSIM_OK, VSIM_HALTED or VSIM_ERROR
+int vsim_step(vsim* sim);
+// to HALT, or at most max_instrs instrs if not 0,
+// VSIM_HALTED, VSIM_RUNNING or VSIM_ERROR
+int vsim_run(vsim* sim, uint64_t max_instrs);
+// instrs run since the last reset or load, HALT included
+uint64_t vsim_instr_count(const vsim* sim);
+int32_t vsim_pc(const vsim* sim);
+
+// Registers
+// *out is only written on VSIM_OK
+int vsim_read_sreg(const vsim* sim, int reg, int32_t* out);
+// SR0 can't be written
+int vsim_write_sreg(vsim* sim, int reg, int32_t value);
+// the 64 32 bit words of a vector register, packed at element widths < 32
+int vsim_read_vreg(const vsim* sim, int reg, int32_t out[64]);
+int32_t vsim_vlen(const vsim* sim);
+// element width, 8, 16 or 32
+int32_t vsim_ew(const vsim* sim);
+// one byte per element, 64 at 32 bit elements and up to 256 at 8 bits,
+// returns the number written
+int vsim_read_vmask(const vsim* sim, uint8_t out[256]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,30 +2,58 @@
 #include <filesystem>
 #include "core.h"
 #include "common.h"
-#include "register.h"
-#include "parse_asm.h"
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <iodir>\n";
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <iodir> [--bin] [--dump full|delta]\n";
         return 1;
     }
 
     std::filesystem::path iodir = argv[1];
-    FunctionalSimulator fs(iodir);
-    fs.run();
+    bool use_bin = false;
+    std::string dump = "full";
 
-    // Call the splitString function
-    std::vector<Instruction> instrs = parseAsm(iodir / ASM_CODE_FN);
+    for (int i = 2; i < argc; i++) {
+        std::string opt = argv[i];
+        if (opt == "--bin")
+            use_bin = true;
+        else if (opt == "--dump") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << opt << "\n";
+                return 1;
+            }
+            dump = argv[++i];
+        }
+        else {
+            std::cerr << "Unknown option: " << opt << "\n";
+            return 1;
+        }
+    }
+    if (dump != "full" && dump != "delta") {
+        std::cerr << "--dump must be full or delta\n";
+        return 1;
+    }
 
-    for (auto instr : instrs) {
-        std::cout << instr.name << " ";
-        std::cout << instr.op1 <<  " ";
-        std::cout << instr.op2 <<  " ";
-        std::cout << instr.op3 <<  " ";
-        std::cout << "; " << instr.num_of_ops <<  "\n";
+    try {
+        // Code.asm, or only Code.bin from the assembler
+        FunctionalSimulator fs(iodir, use_bin);
+        fs.run();
+        std::cout << "Ran " << fs.getInstrCount() << " instrs" << std::endl;
 
+        fs.dumpRegs(iodir);
+        if (dump == "delta") {
+            fs.sdmem().dumpDelta(iodir / SDMEM_DELTA_FN, "SDMEM");
+            fs.vdmem().dumpDelta(iodir / VDMEM_DELTA_FN, "VDMEM");
+        } else {
+            fs.sdmem().dump(iodir / SDMEM_OP_FN);
+            fs.vdmem().dump(iodir / VDMEM_OP_FN);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
     }
+    std::cout << "Saved VRF.txt, SRF.txt and the SDMEM/VDMEM outputs in " << iodir.string() << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
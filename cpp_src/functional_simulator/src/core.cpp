@@ -1,28 +1,446 @@
 #include <string>
+#include <algorithm>
+#include <stdexcept>
 #include <filesystem>
 #include "core.h"
 #include "common.h"
+#include "packed.h"
+#include "parse_asm.h"
 
-#include <iostream>
+// Python style floor division, the Python simulator uses //
+static int64_t floorDiv(int64_t x, int64_t y) {
+    if (y == 0) {
+        throw std::domain_error("Division by zero");
+    }
+    int64_t q = x / y;
+    return (x % y != 0 && (x < 0) != (y < 0)) ? q - 1 : q;
+}
+
+static bool compareOp(INSTRUCTION op, int32_t x, int32_t y) {
+    switch (op) {
+        case SEQVV: case SEQVS: case BEQ: return x == y;
+        case SNEVV: case SNEVS: case BNE: return x != y;
+        case SGTVV: case SGTVS: case BGT: return x > y;
+        case SLTVV: case SLTVS: case BLT: return x < y;
+        case SGEVV: case SGEVS: case BGE: return x >= y;
+        default:                          return x <= y; // SLEVV, SLEVS, BLE
+    }
+}
 
-FunctionalSimulator::FunctionalSimulator(const std::filesystem::path iodir) : 
-    SDMEM(iodir / SDMEM_FN, SDMEM_SIZE), 
-    VDMEM(iodir / SDMEM_FN, SDMEM_SIZE),
+FunctionalSimulator::FunctionalSimulator() :
+    SDMEM(SDMEM_SIZE),
+    VDMEM(VDMEM_SIZE),
     SREG(SREG_SHAPE),
     VREG(VREG_SHAPE),
-    VMASK_REG(VMASK_REG_SHAPE) {
-    
-    // check if iodir is a valid path
-    // filter comments and decode assembly code into struct
-    // verify assembly code 
-}
-
-void FunctionalSimulator::run() {
-    // run
-    
-    // IF
-    // ID
-    // EX
-    // MEM
-    // WB
-}
\ No newline at end of file
+    VMASK(MAX_LANES, 1),
+    elems1(MAX_LANES),
+    elems2(MAX_LANES),
+    elems3(MAX_LANES) {
+}
+
+FunctionalSimulator::FunctionalSimulator(const std::filesystem::path iodir, bool use_bin) : FunctionalSimulator() {
+    if (!std::filesystem::is_directory(iodir)) {
+        throw std::runtime_error("Not a directory: " + iodir.string());
+    }
+    this->SDMEM.load(iodir / SDMEM_FN);
+    this->VDMEM.load(iodir / VDMEM_FN);
+    this->loadProgram(use_bin ? parseBin(iodir / BIN_CODE_FN) : parseAsm(iodir / ASM_CODE_FN));
+}
+
+void FunctionalSimulator::loadProgram(const std::vector<Instruction>& instrs) {
+    this->program = instrs;
+    this->resetCore();
+}
+
+void FunctionalSimulator::resetCore() {
+    this->SREG.reset();
+    this->VREG.reset();
+    std::fill(this->VMASK.begin(), this->VMASK.end(), 1);
+    this->pc = 0;
+    this->vlen = MAX_VECTOR_LEN;
+    this->ew = REG_BITS;
+    this->halted = false;
+    this->instr_count = 0;
+}
+
+void FunctionalSimulator::reset() {
+    this->resetCore();
+    this->SDMEM.reset();
+    this->VDMEM.reset();
+}
+
+bool FunctionalSimulator::step() {
+    if (this->halted) {
+        return false;
+    }
+    if (this->pc < 0 || this->pc >= (int)this->program.size()) {
+        throw std::out_of_range("PC " + std::to_string(this->pc) + " is outside the program of " + std::to_string(this->program.size()) + " instrs");
+    }
+
+    const Instruction& instr = this->program[this->pc];
+    try {
+        this->execute(instr);
+    }
+    catch (const std::exception& e) {
+        throw std::runtime_error("PC " + std::to_string(this->pc) + " (" + instr.name + "): " + e.what());
+    }
+    this->instr_count++;
+    return !this->halted;
+}
+
+uint64_t FunctionalSimulator::run(uint64_t max_instrs) {
+    uint64_t start = this->instr_count;
+    while (!this->halted && (max_instrs == 0 || this->instr_count - start < max_instrs)) {
+        this->step();
+    }
+    return this->instr_count - start;
+}
+
+// ---- Operands ----
+
+int FunctionalSimulator::mvl() const {
+    return MAX_VECTOR_LEN * REG_BITS / this->ew;
+}
+
+int FunctionalSimulator::lanesPerWord() const {
+    return REG_BITS / this->ew;
+}
+
+int32_t FunctionalSimulator::readSreg(const Operand& op) const {
+    return this->SREG.read(op.value, 0);
+}
+
+void FunctionalSimulator::writeSreg(const Operand& op, int32_t value) {
+    if (op.value != 0) {
+        this->SREG.write(op.value, 0, value);
+    }
+}
+
+void FunctionalSimulator::readVec(const Operand& op, int32_t* elems) const {
+    if (op.type == SCALAR) {
+        // a VS op's scalar, the same for every element
+        std::fill(elems, elems + this->mvl(), this->readSreg(op));
+        return;
+    }
+    unpackWords(this->VREG.row(op.value), MAX_VECTOR_LEN, this->ew, elems);
+}
+
+void FunctionalSimulator::writeVec(const Operand& op, const int32_t* elems) {
+    if (op.value != 0) {
+        packWords(elems, MAX_VECTOR_LEN, this->ew, this->VREG.row(op.value));
+    }
+}
+
+int32_t FunctionalSimulator::readElem(int64_t addr) const {
+    int k = this->lanesPerWord();
+    if (addr < 0 || addr / k > INT32_MAX) {
+        throw std::out_of_range("Invalid memory access at element address: " + std::to_string(addr));
+    }
+    int32_t word = this->VDMEM.read(int32_t(addr / k));
+    return k == 1 ? word : getElem(word, int(addr % k), this->ew);
+}
+
+void FunctionalSimulator::writeElem(int64_t addr, int32_t value) {
+    int k = this->lanesPerWord();
+    if (addr < 0 || addr / k > INT32_MAX) {
+        throw std::out_of_range("Invalid memory access at element address: " + std::to_string(addr));
+    }
+    int32_t word_addr = int32_t(addr / k);
+    if (k == 1) {
+        this->VDMEM.write(word_addr, value);
+    } else {
+        this->VDMEM.write(word_addr, setElem(this->VDMEM.read(word_addr), int(addr % k), value, this->ew));
+    }
+}
+
+// ---- Execution ----
+
+void FunctionalSimulator::execute(const Instruction& instr) {
+    int next_pc = this->pc + 1;
+
+    switch (instr.op) {
+        case ADD: case SUB: case AND: case OR: case XOR: case SLL: case SRL: case SRA:
+            this->scalarOp(instr);
+            break;
+        case ADDVV: case SUBVV: case MULVV: case DIVVV: case ADDVS: case SUBVS: case MULVS: case DIVVS:
+            this->vectorOp(instr);
+            break;
+        case SEQVV: case SNEVV: case SGTVV: case SLTVV: case SGEVV: case SLEVV:
+        case SEQVS: case SNEVS: case SGTVS: case SLTVS: case SGEVS: case SLEVS:
+            this->compare(instr);
+            break;
+        case LV: case LVWS: case LVI:
+            this->loadVec(instr);
+            break;
+        case SV: case SVWS: case SVI:
+            this->storeVec(instr);
+            break;
+        case PACKLO: case PACKHI: case UNPACKLO: case UNPACKHI:
+            this->shuffle(instr);
+            break;
+        case MACW:
+            this->macw(instr);
+            break;
+        case SVN:
+            this->svn(instr);
+            break;
+        case LS: // load SDMEM[SR2 + imm] into SR1
+            this->writeSreg(instr.op1, this->SDMEM.read(this->readSreg(instr.op2) + instr.op3.value));
+            break;
+        case SS: // store SR1 in SDMEM[SR2 + imm]
+            this->SDMEM.write(this->readSreg(instr.op2) + instr.op3.value, this->readSreg(instr.op1));
+            break;
+        case BEQ: case BNE: case BGT: case BLT: case BGE: case BLE:
+            if (compareOp(instr.op, this->readSreg(instr.op1), this->readSreg(instr.op2)))
+                next_pc = this->pc + instr.op3.value;
+            break;
+        case CVM: // clear vector mask register - set to all 1's
+            std::fill(this->VMASK.begin(), this->VMASK.end(), 1);
+            break;
+        case POP: // number of 1s in the vector mask register
+            this->writeSreg(instr.op1, (int32_t)std::count(this->VMASK.begin(), this->VMASK.begin() + this->mvl(), 1));
+            break;
+        case MTCL: {
+            int32_t len = this->readSreg(instr.op1);
+            if (len < 0 || len > this->mvl()) {
+                throw std::out_of_range("Vector length " + std::to_string(len) + " is outside 0-" + std::to_string(this->mvl()));
+            }
+            this->vlen = len;
+            break;
+        }
+        case MFCL:
+            this->writeSreg(instr.op1, this->vlen);
+            break;
+        case MTEW: { // element width, and the vector len is the max for it
+            int32_t width = this->readSreg(instr.op1);
+            if (!validElementWidth(width)) {
+                throw std::invalid_argument("Invalid element width " + std::to_string(width) + ", must be 8, 16 or 32");
+            }
+            this->ew = width;
+            this->vlen = this->mvl();
+            break;
+        }
+        case MFEW:
+            this->writeSreg(instr.op1, this->ew);
+            break;
+        case BARRIER: // only waits for other cores, a single core has none
+            break;
+        case HALT:
+            this->halted = true;
+            next_pc = this->pc;
+            break;
+    }
+
+    this->pc = next_pc;
+}
+
+void FunctionalSimulator::scalarOp(const Instruction& instr) {
+    int64_t x = this->readSreg(instr.op2), y = this->readSreg(instr.op3);
+    int64_t res = 0;
+    // shift amounts use the low 5 bits, like MIPS
+    switch (instr.op) {
+        case ADD: res = x + y; break;
+        case SUB: res = x - y; break;
+        case AND: res = x & y; break;
+        case OR:  res = x | y; break;
+        case XOR: res = x ^ y; break;
+        case SLL: res = int64_t(uint32_t(x) << (y & 31)); break;
+        case SRL: res = int64_t(uint32_t(x) >> (y & 31)); break;
+        default:  res = int32_t(x) >> (y & 31); break; // SRA
+    }
+    this->writeSreg(instr.op1, wrapElem(res, REG_BITS));
+}
+
+void FunctionalSimulator::vectorOp(const Instruction& instr) {
+    // elements past the vector length and masked elements keep their old value
+    int32_t* dst = this->elems1.data();
+    int32_t* a = this->elems2.data();
+    int32_t* b = this->elems3.data();
+    this->readVec(instr.op1, dst);
+    this->readVec(instr.op2, a);
+    this->readVec(instr.op3, b);
+
+    switch (instr.op) {
+        case ADDVV: case ADDVS:
+            packedOp(PACKED_ADD, a, b, dst, this->vlen, this->ew, this->VMASK.data());
+            break;
+        case SUBVV: case SUBVS:
+            packedOp(PACKED_SUB, a, b, dst, this->vlen, this->ew, this->VMASK.data());
+            break;
+        case MULVV: case MULVS:
+            packedOp(PACKED_MUL, a, b, dst, this->vlen, this->ew, this->VMASK.data());
+            break;
+        default: // DIVVV, DIVVS
+            for (int i = 0; i < this->vlen; i++) {
+                if (this->VMASK[i])
+                    dst[i] = wrapElem(floorDiv(a[i], b[i]), this->ew);
+            }
+            break;
+    }
+    this->writeVec(instr.op1, dst);
+}
+
+void FunctionalSimulator::compare(const Instruction& instr) {
+    // sets the mask of the first vlen elements
+    int32_t* a = this->elems2.data();
+    int32_t* b = this->elems3.data();
+    this->readVec(instr.op1, a);
+    this->readVec(instr.op2, b);
+
+    for (int i = 0; i < this->vlen; i++) {
+        this->VMASK[i] = compareOp(instr.op, a[i], b[i]);
+    }
+}
+
+void FunctionalSimulator::loadVec(const Instruction& instr) {
+    // packed elements are addressed from the start of the word at SR2, strides and indices are in elements
+    int32_t* dst = this->elems1.data();
+    int32_t* idx = this->elems3.data();
+    int64_t base = int64_t(this->readSreg(instr.op2)) * this->lanesPerWord();
+    this->readVec(instr.op1, dst);
+
+    if (instr.op == LVI) { // gather, not masked
+        this->readVec(instr.op3, idx);
+        for (int i = 0; i < this->vlen; i++) {
+            dst[i] = this->readElem(base + idx[i]);
+        }
+    }
+    else {
+        int64_t stride = instr.op == LVWS ? this->readSreg(instr.op3) : 1;
+        for (int i = 0; i < this->vlen; i++) {
+            if (this->VMASK[i])
+                dst[i] = this->readElem(base + stride * i);
+        }
+    }
+    this->writeVec(instr.op1, dst);
+}
+
+void FunctionalSimulator::storeVec(const Instruction& instr) {
+    int32_t* src = this->elems1.data();
+    int32_t* idx = this->elems3.data();
+    int64_t base = int64_t(this->readSreg(instr.op2)) * this->lanesPerWord();
+    this->readVec(instr.op1, src);
+
+    if (instr.op == SVI) { // scatter, not masked
+        this->readVec(instr.op3, idx);
+        for (int i = 0; i < this->vlen; i++) {
+            this->writeElem(base + idx[i], src[i]);
+        }
+    }
+    else {
+        // masked elements aren't stored
+        int64_t stride = instr.op == SVWS ? this->readSreg(instr.op3) : 1;
+        for (int i = 0; i < this->vlen; i++) {
+            if (this->VMASK[i])
+                this->writeElem(base + stride * i, src[i]);
+        }
+    }
+}
+
+void FunctionalSimulator::shuffle(const Instruction& instr) {
+    // same as the Python simulator, over the first vlen elements, the rest of VR1 is zeroed
+    int n = this->vlen;
+    int32_t* dst = this->elems1.data();
+    int32_t* a = this->elems2.data();
+    int32_t* b = this->elems3.data();
+    this->readVec(instr.op2, a);
+    this->readVec(instr.op3, b);
+    std::fill(dst, dst + MAX_LANES, 0);
+
+    if (instr.op == UNPACKLO || instr.op == UNPACKHI) {
+        // interleave the low (or high) halves of VR2 and VR3
+        int offset = instr.op == UNPACKHI ? n / 2 : 0;
+        for (int i = 0; i < n; i += 2) {
+            dst[i] = a[offset + i / 2];
+            dst[i + 1] = b[offset + i / 2];
+        }
+    }
+    else {
+        // even (or odd) elements of VR2, then those of VR3
+        int odd = instr.op == PACKHI;
+        for (int i = 0, j = 0; i < n; i += 2, j++) {
+            dst[j] = a[i + odd];
+            dst[j + n / 2] = b[i + odd];
+        }
+    }
+    this->writeVec(instr.op1, dst);
+}
+
+void FunctionalSimulator::macw(const Instruction& instr) {
+    // VR1 holds 32 bit accumulators whatever the element width
+    int32_t* a = this->elems2.data();
+    int32_t* b = this->elems3.data();
+    this->readVec(instr.op2, a);
+    this->readVec(instr.op3, b);
+
+    if (instr.op1.value != 0) {
+        packedMacw(a, b, this->VREG.row(instr.op1.value), this->vlen, this->ew, this->VMASK.data());
+    }
+}
+
+void FunctionalSimulator::svn(const Instruction& instr) {
+    // clamps the 32 bit elements of VR1 to the element width and stores them packed
+    int32_t* narrowed = this->elems1.data();
+    int64_t base = int64_t(this->readSreg(instr.op2)) * this->lanesPerWord();
+    int n = packedNarrow(this->VREG.row(instr.op1.value), this->vlen, this->ew, narrowed, this->VMASK.data());
+
+    for (int i = 0; i < n; i++) {
+        if (this->VMASK[i])
+            this->writeElem(base + i, narrowed[i]);
+    }
+}
+
+// ---- State ----
+
+bool FunctionalSimulator::isHalted() const {
+    return this->halted;
+}
+
+int FunctionalSimulator::getPc() const {
+    return this->pc;
+}
+
+int FunctionalSimulator::getVlen() const {
+    return this->vlen;
+}
+
+int FunctionalSimulator::getEw() const {
+    return this->ew;
+}
+
+uint64_t FunctionalSimulator::getInstrCount() const {
+    return this->instr_count;
+}
+
+const uint8_t* FunctionalSimulator::vectorMask() const {
+    return this->VMASK.data();
+}
+
+Memory& FunctionalSimulator::sdmem() {
+    return this->SDMEM;
+}
+
+Memory& FunctionalSimulator::vdmem() {
+    return this->VDMEM;
+}
+
+Register& FunctionalSimulator::sreg() {
+    return this->SREG;
+}
+
+Register& FunctionalSimulator::vreg() {
+    return this->VREG;
+}
+
+const Register& FunctionalSimulator::sreg() const {
+    return this->SREG;
+}
+
+const Register& FunctionalSimulator::vreg() const {
+    return this->VREG;
+}
+
+void FunctionalSimulator::dumpRegs(const std::filesystem::path iodir) const {
+    this->VREG.dump(iodir / VRF_OP_FN);
+    this->SREG.dump(iodir / SRF_OP_FN);
+}
@@ -2,41 +2,135 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <stdexcept>
 #include "memory.h" 
 
 // BASE MEMORY CLASS
 
-Memory::Memory(const std::filesystem::path fp, int size) {
-    this->size = size;
-    this->data = new int32_t[size];
+const int32_t Memory::ZERO_PAGE[Memory::PAGE_SIZE] = {};
+
+Memory::Memory(int size) {
+    this->capacity = size;
+    this->clearImage();
+};
+
+Memory::Memory(const std::filesystem::path fp, int size) : Memory(size) {
+    this->load(fp);
+};
+
+void Memory::clearImage() {
+    int num_pages = (this->capacity + PAGE_SIZE - 1) / PAGE_SIZE;
+    this->size = this->capacity;
+    this->buffer = nullptr;
+    this->base_pages.clear();
+    this->base_pages.resize(num_pages);
+    this->dirty_pages.clear();
+    this->dirty_pages.resize(num_pages);
+    this->image_pages.assign(num_pages, ZERO_PAGE);
+    this->pages = this->image_pages;
+};
+
+void Memory::load(const std::filesystem::path fp) {
     std::ifstream file(fp);
 
     if (!file.is_open()) {
         throw std::runtime_error("Error opening file: " + fp.string());  // Throw exception on error
     }
 
+    this->clearImage();
     std::string line;
     int32_t addr = 0;
 
-    // Read the file line by line
+    // Read the file line by line, only the pages it covers are allocated
     while (std::getline(file, line)) {
-        this->data[addr] = std::stoi(line);
+        this->checkAddr(addr);
+        int page = addr >> PAGE_BITS;
+        if (!this->base_pages[page]) {
+            this->base_pages[page] = std::make_unique<int32_t[]>(PAGE_SIZE); // zeroed
+            this->image_pages[page] = this->base_pages[page].get();
+        }
+        this->base_pages[page][addr & (PAGE_SIZE - 1)] = std::stoi(line);
         addr++;
     }
+    this->pages = this->image_pages;
 
     // Close the file
     file.close();
 };
 
-int32_t Memory::read(int32_t addr) {
-    return this->data[addr];
+void Memory::loadImage(const int32_t* image, int n_words) {
+    if (n_words < 0 || n_words > this->capacity) {
+        throw std::out_of_range("Image of " + std::to_string(n_words) + " words doesn't fit in memory of " + std::to_string(this->capacity) + " words");
+    }
+
+    this->clearImage();
+    // full pages point into the image, the last partial page is copied so reads stay inside it
+    for (int32_t start=0; start<n_words; start+=PAGE_SIZE) {
+        int page = start >> PAGE_BITS;
+        if (n_words - start >= PAGE_SIZE) {
+            this->image_pages[page] = image + start;
+        } else {
+            this->base_pages[page] = std::make_unique<int32_t[]>(PAGE_SIZE); // zeroed
+            std::copy(image + start, image + n_words, this->base_pages[page].get());
+            this->image_pages[page] = this->base_pages[page].get();
+        }
+    }
+    this->pages = this->image_pages;
+};
+
+void Memory::mapBuffer(int32_t* buffer, int n_words) {
+    if (n_words < 0 || n_words > this->capacity) {
+        throw std::out_of_range("Buffer of " + std::to_string(n_words) + " words doesn't fit in memory of " + std::to_string(this->capacity) + " words");
+    }
+
+    this->clearImage();
+    this->buffer = buffer;
+    this->size = n_words;
+};
+
+void Memory::reset() {
+    for (std::unique_ptr<int32_t[]>& page : this->dirty_pages) {
+        page.reset();
+    }
+    this->pages = this->image_pages;
+};
+
+void Memory::checkAddr(int32_t addr) const {
+    if (addr < 0 || addr >= this->size) {
+        throw std::out_of_range("Invalid memory access at address: " + std::to_string(addr));
+    }
+};
+
+int32_t Memory::read(int32_t addr) const {
+    this->checkAddr(addr);
+    if (this->buffer) {
+        return this->buffer[addr];
+    }
+    return this->pages[addr >> PAGE_BITS][addr & (PAGE_SIZE - 1)];
 };
 
 void Memory::write(int32_t addr, int32_t value) {
-    this->data[addr] = value;
+    this->checkAddr(addr);
+    if (this->buffer) {
+        this->buffer[addr] = value;
+        return;
+    }
+    int page = addr >> PAGE_BITS;
+    if (!this->dirty_pages[page]) {
+        // first write, copy the page
+        this->dirty_pages[page] = std::make_unique<int32_t[]>(PAGE_SIZE);
+        std::copy(this->pages[page], this->pages[page] + PAGE_SIZE, this->dirty_pages[page].get());
+        this->pages[page] = this->dirty_pages[page].get();
+    }
+    this->dirty_pages[page][addr & (PAGE_SIZE - 1)] = value;
+};
+
+int Memory::getSize() const {
+    return this->size;
 };
 
-void Memory::dump(const std::filesystem::path fp) {
+void Memory::dump(const std::filesystem::path fp) const {
     // Open the file for writing (it will overwrite if it exists)
     std::ofstream outFile(fp);
 
@@ -44,14 +138,71 @@ void Memory::dump(const std::filesystem::path fp) {
         throw std::runtime_error("Error opening file: " + fp.string());  // Throw exception on error
     }
 
-    // Write the array contents to the file
-    for (int32_t addr=0; addr<this->size; addr++) {
-        outFile << this->data[addr] << std::endl;
+    if (this->buffer) {
+        for (int32_t i=0; i<this->size; i++) {
+            outFile << this->buffer[i] << '\n';
+        }
+        outFile.close();
+        return;
+    }
+
+    // Write the memory contents to the file, zero pages are written as one block
+    std::string zero_lines;
+    for (int i=0; i<PAGE_SIZE; i++) {
+        zero_lines += "0\n";
+    }
+
+    for (int32_t page=0; page<(int32_t)this->pages.size(); page++) {
+        int32_t start = page << PAGE_BITS;
+        int32_t n = std::min(PAGE_SIZE, this->size - start);
+        if (this->pages[page] == ZERO_PAGE) {
+            outFile.write(zero_lines.data(), 2 * n);
+            continue;
+        }
+        for (int32_t i=0; i<n; i++) {
+            outFile << this->pages[page][i] << '\n';
+        }
     }
     // Close the file
     outFile.close();
 };
 
-Memory::~Memory() {
-    delete[] this->data;
-};
\ No newline at end of file
+void Memory::dumpDelta(const std::filesystem::path fp, const std::string& name) const {
+    if (this->buffer) {
+        throw std::runtime_error("A mapped buffer has no input image to diff against: " + fp.string());
+    }
+
+    std::ofstream outFile(fp);
+
+    if (!outFile.is_open()) {
+        throw std::runtime_error("Error opening file: " + fp.string());  // Throw exception on error
+    }
+
+    outFile << "# " << name << " changes from " << name << ".txt, " << this->size << " words\n";
+
+    // only written pages can differ from the input image
+    int32_t next_addr = -1; // addr right after the last written word
+    for (int32_t page=0; page<(int32_t)this->dirty_pages.size(); page++) {
+        if (!this->dirty_pages[page]) {
+            continue;
+        }
+        const int32_t* base = this->image_pages[page];
+        for (int32_t i=0; i<PAGE_SIZE; i++) {
+            if (this->dirty_pages[page][i] == base[i]) {
+                continue;
+            }
+            int32_t addr = (page << PAGE_BITS) + i;
+            if (addr != next_addr) {
+                outFile << "@ " << addr << '\n';
+            }
+            outFile << this->dirty_pages[page][i] << '\n';
+            next_addr = addr + 1;
+        }
+    }
+    outFile.close();
+};
+
+int Memory::dirtyPageCount() const {
+    return (int)std::count_if(this->dirty_pages.begin(), this->dirty_pages.end(),
+                              [](const std::unique_ptr<int32_t[]>& page) { return page != nullptr; });
+};
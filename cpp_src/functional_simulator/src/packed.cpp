@@ -0,0 +1,127 @@
+#include <algorithm>
+#include "packed.h"
+
+const int WORD_BITS = 32;
+const int MAX_VECTOR_LEN = 64; // words in a vector register
+
+bool validElementWidth(int ew) {
+    return std::find(ELEMENT_WIDTHS, ELEMENT_WIDTHS + 3, ew) != ELEMENT_WIDTHS + 3;
+}
+
+int32_t wrapElem(int64_t val, int ew) {
+    uint64_t mask = (uint64_t(1) << ew) - 1;
+    uint64_t bits = uint64_t(val) & mask;
+    return int32_t(bits >> (ew - 1) ? int64_t(bits) - (int64_t(1) << ew) : int64_t(bits));
+}
+
+int32_t saturateElem(int64_t val, int ew) {
+    int64_t hi = (int64_t(1) << (ew - 1)) - 1;
+    return int32_t(std::clamp(val, -hi - 1, hi));
+}
+
+int32_t getElem(int32_t word, int lane, int ew) {
+    return wrapElem(int64_t(word) >> (ew * lane), ew);
+}
+
+int32_t setElem(int32_t word, int lane, int32_t val, int ew) {
+    uint32_t mask = uint32_t((uint64_t(1) << ew) - 1) << (ew * lane);
+    uint32_t bits = (uint32_t(word) & ~mask) | ((uint32_t(val) << (ew * lane)) & mask);
+    return int32_t(bits);
+}
+
+void unpackWords(const int32_t* words, int n_words, int ew, int32_t* elems) {
+    int k = WORD_BITS / ew;
+    for (int w = 0; w < n_words; w++) {
+        for (int lane = 0; lane < k; lane++)
+            elems[w * k + lane] = getElem(words[w], lane, ew);
+    }
+}
+
+void packWords(const int32_t* elems, int n_words, int ew, int32_t* words) {
+    int k = WORD_BITS / ew;
+    for (int w = 0; w < n_words; w++) {
+        int32_t word = 0;
+        for (int lane = 0; lane < k; lane++)
+            word = setElem(word, lane, elems[w * k + lane], ew);
+        words[w] = word;
+    }
+}
+
+// The loops below run to n rounded up to a whole block, so the compiler knows
+// their trip count is a multiple of the vector width and vectorizes them at
+// -O2 without a scalar epilogue. Elements past n are computed but not written
+static inline int roundBlock(int n) {
+    return (n + PACKED_BLOCK - 1) & ~(PACKED_BLOCK - 1);
+}
+
+// all ones where element i is written, unmasked and below n, for a branchless select
+static inline int32_t selectMask(const uint8_t* mask, int i, int n) {
+    return -int32_t((mask[i] != 0) & (i < n));
+}
+
+template <typename F>
+static void blockOp(F f, const int32_t* __restrict__ a, const int32_t* __restrict__ b, int32_t* __restrict__ dst,
+                    int n, int ew, const uint8_t* __restrict__ mask) {
+    // unsigned 32 bit arithmetic wraps, shifting up and back sign extends the low ew bits
+    int shift = WORD_BITS - ew;
+    int n_block = roundBlock(n);
+    for (int i = 0; i < n_block; i++) {
+        int32_t res = int32_t(f(uint32_t(a[i]), uint32_t(b[i])) << shift) >> shift;
+        int32_t sel = selectMask(mask, i, n);
+        dst[i] = (res & sel) | (dst[i] & ~sel);
+    }
+}
+
+void packedOp(PackedOp op, const int32_t* a, const int32_t* b, int32_t* dst, int n, int ew, const uint8_t* mask) {
+    switch (op) {
+        case PACKED_ADD: blockOp([](uint32_t x, uint32_t y) { return x + y; }, a, b, dst, n, ew, mask); break;
+        case PACKED_SUB: blockOp([](uint32_t x, uint32_t y) { return x - y; }, a, b, dst, n, ew, mask); break;
+        case PACKED_MUL: blockOp([](uint32_t x, uint32_t y) { return x * y; }, a, b, dst, n, ew, mask); break;
+    }
+}
+
+// MACW with K elements per word
+template <int K>
+static void macwWords(const int32_t* __restrict__ a, const int32_t* __restrict__ b, int32_t* __restrict__ acc,
+                      int n, const uint8_t* __restrict__ mask) {
+    int n_words = roundBlock((n + K - 1) / K);
+    // masked and trailing elements give 0, so whole blocks of words can be added
+    uint32_t prod[MAX_VECTOR_LEN * K];
+    int n_prod = roundBlock(n_words * K);
+    for (int i = 0; i < n_prod; i++)
+        prod[i] = uint32_t(a[i]) * uint32_t(b[i]) & uint32_t(selectMask(mask, i, n));
+
+    for (int j = 0; j < n_words; j++) {
+        uint32_t sum = 0;
+        for (int e = 0; e < K; e++)
+            sum += prod[j * K + e];
+        acc[j] = int32_t(uint32_t(acc[j]) + sum);
+    }
+}
+
+void packedMacw(const int32_t* a, const int32_t* b, int32_t* acc, int n, int ew, const uint8_t* mask) {
+    switch (WORD_BITS / ew) {
+        case 4:  macwWords<4>(a, b, acc, n, mask); break;
+        case 2:  macwWords<2>(a, b, acc, n, mask); break;
+        default: macwWords<1>(a, b, acc, n, mask); break;
+    }
+}
+
+static void narrow(const int32_t* __restrict__ src, int n_out, int ew, int32_t* __restrict__ dst_elems,
+                   const uint8_t* __restrict__ mask) {
+    int32_t hi = int32_t(~uint32_t(0) >> (WORD_BITS - ew + 1));
+    int32_t lo = -hi - 1;
+    int n_block = roundBlock(n_out);
+    for (int i = 0; i < n_block; i++) {
+        int32_t res = std::min(std::max(src[i], lo), hi);
+        int32_t sel = selectMask(mask, i, n_out);
+        dst_elems[i] = (res & sel) | (dst_elems[i] & ~sel);
+    }
+}
+
+int packedNarrow(const int32_t* src, int n, int ew, int32_t* dst_elems, const uint8_t* mask) {
+    int k = WORD_BITS / ew;
+    int n_out = (n + k - 1) / k;
+    narrow(src, n_out, ew, dst_elems, mask);
+    return n_out;
+}
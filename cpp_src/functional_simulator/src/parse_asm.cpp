@@ -1,6 +1,116 @@
 #include <fstream>
+#include <sstream>
 #include <regex>
-#include "common.h"
+#include <cstring>
+#include <stdexcept>
+#include "parse_asm.h"
+
+// Encoding and operands of each instr, same as the assembler's op_map.
+// operands has one char per operand: S scalar reg, V vector reg, I immediate.
+// Instrs whose last operand is an immediate are I-type and have no funct
+struct InstrInfo {
+    INSTRUCTION op;
+    const char* name;
+    int opcode;
+    int funct6;
+    const char* operands;
+};
+
+static const InstrInfo ISA[] = {
+    {ADDVV, "ADDVV", 0b100000, 0b000000, "VVV"},
+    {SUBVV, "SUBVV", 0b100000, 0b000001, "VVV"},
+    {MULVV, "MULVV", 0b100000, 0b000010, "VVV"},
+    {DIVVV, "DIVVV", 0b100000, 0b000011, "VVV"},
+    {ADDVS, "ADDVS", 0b100001, 0b000000, "VVS"},
+    {SUBVS, "SUBVS", 0b100001, 0b000001, "VVS"},
+    {MULVS, "MULVS", 0b100001, 0b000010, "VVS"},
+    {DIVVS, "DIVVS", 0b100001, 0b000011, "VVS"},
+    {SEQVV, "SEQVV", 0b100000, 0b000100, "VV"},
+    {SNEVV, "SNEVV", 0b100000, 0b000101, "VV"},
+    {SGTVV, "SGTVV", 0b100000, 0b000110, "VV"},
+    {SLTVV, "SLTVV", 0b100000, 0b000111, "VV"},
+    {SGEVV, "SGEVV", 0b100000, 0b001000, "VV"},
+    {SLEVV, "SLEVV", 0b100000, 0b001001, "VV"},
+    {SEQVS, "SEQVS", 0b100001, 0b000100, "VS"},
+    {SNEVS, "SNEVS", 0b100001, 0b000101, "VS"},
+    {SGTVS, "SGTVS", 0b100001, 0b000110, "VS"},
+    {SLTVS, "SLTVS", 0b100001, 0b000111, "VS"},
+    {SGEVS, "SGEVS", 0b100001, 0b001000, "VS"},
+    {SLEVS, "SLEVS", 0b100001, 0b001001, "VS"},
+    {CVM, "CVM", 0b000001, 0b000000, ""},
+    {POP, "POP", 0b000010, 0b000001, "S"},
+    {MTCL, "MTCL", 0b000011, 0b000010, "S"},
+    {MFCL, "MFCL", 0b000100, 0b000011, "S"},
+    {LV, "LV", 0b100010, 0b000000, "VS"},
+    {SV, "SV", 0b100011, 0b000000, "VS"},
+    {LVWS, "LVWS", 0b100100, 0b000000, "VSS"},
+    {SVWS, "SVWS", 0b100101, 0b000000, "VSS"},
+    {LVI, "LVI", 0b100110, 0b000000, "VSV"},
+    {SVI, "SVI", 0b100111, 0b000000, "VSV"},
+    {LS, "LS", 0b000101, 0, "SSI"},
+    {SS, "SS", 0b000110, 0, "SSI"},
+    {ADD, "ADD", 0b000000, 0b000000, "SSS"},
+    {SUB, "SUB", 0b000000, 0b000001, "SSS"},
+    {AND, "AND", 0b000000, 0b000010, "SSS"},
+    {OR, "OR", 0b000000, 0b000011, "SSS"},
+    {XOR, "XOR", 0b000000, 0b000100, "SSS"},
+    {SLL, "SLL", 0b000000, 0b000101, "SSS"},
+    {SRL, "SRL", 0b000000, 0b000110, "SSS"},
+    {SRA, "SRA", 0b000000, 0b000111, "SSS"},
+    {BEQ, "BEQ", 0b001000, 0, "SSI"},
+    {BNE, "BNE", 0b001001, 0, "SSI"},
+    {BGT, "BGT", 0b001010, 0, "SSI"},
+    {BLT, "BLT", 0b001011, 0, "SSI"},
+    {BGE, "BGE", 0b001100, 0, "SSI"},
+    {BLE, "BLE", 0b001101, 0, "SSI"},
+    {UNPACKLO, "UNPACKLO", 0b100000, 0b001010, "VVV"},
+    {UNPACKHI, "UNPACKHI", 0b100000, 0b001011, "VVV"},
+    {PACKLO, "PACKLO", 0b100000, 0b001100, "VVV"},
+    {PACKHI, "PACKHI", 0b100000, 0b001101, "VVV"},
+    {BARRIER, "BARRIER", 0b000001, 0b000001, ""},
+    {MACW, "MACW", 0b100000, 0b001110, "VVV"},
+    {MTEW, "MTEW", 0b000011, 0b000100, "S"},
+    {MFEW, "MFEW", 0b000100, 0b000101, "S"},
+    {SVN, "SVN", 0b101000, 0b000000, "VS"},
+    {HALT, "HALT", 0b111111, 0b111111, ""},
+};
+
+static bool isIType(const InstrInfo& info) {
+    size_t n = std::strlen(info.operands);
+    return n > 0 && info.operands[n - 1] == 'I';
+}
+
+// S__VV, S__VS, MTCL and MTEW only read registers, so their first operand is in rs
+static bool onlyReads(INSTRUCTION op) {
+    return (op >= SEQVV && op <= SLEVS) || op == MTCL || op == MTEW;
+}
+
+static const InstrInfo& lookupName(const std::string& name) {
+    for (const InstrInfo& info : ISA) {
+        if (name == info.name)
+            return info;
+    }
+    throw std::runtime_error("Unknown instruction: " + name);
+}
+
+static Operand parseOperand(const std::string& str, char kind) {
+    Operand operand;
+    std::smatch match;
+    if (kind == 'I') {
+        if (!std::regex_match(str, std::regex("-?[0-9]+")))
+            throw std::runtime_error("Expected an immediate, got " + str);
+        operand.type = IMM;
+        operand.value = std::stoi(str);
+    }
+    else {
+        std::string prefix = kind == 'V' ? "VR" : "SR";
+        if (!std::regex_match(str, match, std::regex(prefix + "([0-9]+)")) || std::stoi(match[1]) >= SREG_SHAPE[0])
+            throw std::runtime_error("Expected " + prefix + "0-" + prefix + std::to_string(SREG_SHAPE[0] - 1) + ", got " + str);
+        operand.type = kind == 'V' ? VECTOR : SCALAR;
+        operand.value = std::stoi(match[1]);
+    }
+    return operand;
+}
 
 bool isCommentOrEmpty(std::string& line) {
     return line.empty() || line[0] == '#';
@@ -16,17 +126,50 @@ std::string removeInlineComments(std::string& line) {
 // decode assembly code into struct
 Instruction str2Struct(std::string& line) {
     std::vector<std::string> parts = splitString(line);
+    const InstrInfo& info = lookupName(parts[0]);
+    int num_of_ops = (int)parts.size() - 1;
+
+    if (num_of_ops != (int)std::strlen(info.operands)) {
+        throw std::runtime_error(parts[0] + " takes " + std::to_string(std::strlen(info.operands)) + " operands, got " + std::to_string(num_of_ops));
+    }
 
     Instruction instr;
+    instr.op = info.op;
     instr.name = parts[0];
-    instr.op1 = parts[1];
-    instr.op2 = parts[2];
-    instr.op3 = parts[3];
-    instr.num_of_ops = (int)parts.size() - 1;
+    Operand* ops[3] = {&instr.op1, &instr.op2, &instr.op3};
+    for (int i = 0; i < num_of_ops; i++) {
+        *ops[i] = parseOperand(parts[i + 1], info.operands[i]);
+    }
+    instr.num_of_ops = num_of_ops;
 
     return instr;
 }
 
+static std::vector<Instruction> parseAsmStream(std::istream& stream, const std::string& source) {
+    std::string line;
+    std::string trimmed_line;
+    std::string comment_rmed;
+    std::vector<Instruction> instrs;
+    int line_num = 0;
+
+    // Read line by line
+    while (std::getline(stream, line)) {
+        line_num++;
+        trimmed_line = trim(line);
+        if (!isCommentOrEmpty(trimmed_line)) {
+            comment_rmed = removeInlineComments(trimmed_line);
+            try {
+                instrs.push_back(str2Struct(comment_rmed));
+            }
+            catch (const std::exception& e) {
+                throw std::runtime_error(source + ":" + std::to_string(line_num) + ": " + e.what());
+            }
+        }
+    }
+
+    return instrs;
+}
+
 // get code from asm file and put lines in an vector
 std::vector<Instruction> parseAsm(const std::filesystem::path fp) {
     std::ifstream file(fp);
@@ -35,19 +178,96 @@ std::vector<Instruction> parseAsm(const std::filesystem::path fp) {
         throw std::runtime_error("Error opening file: " + fp.string());  // Throw exception on error
     }
 
-    std::string line;
-    std::string trimmed_line;
-    std::string comment_rmed;
-    std::vector<Instruction> instrs;
+    return parseAsmStream(file, fp.string());
+}
 
-    // Read the file line by line
-    while (std::getline(file, line)) {
-        trimmed_line = trim(line);
-        if (!isCommentOrEmpty(trimmed_line)) {
-            comment_rmed = removeInlineComments(trimmed_line);
-            instrs.push_back(str2Struct(comment_rmed));
+std::vector<Instruction> parseAsmString(const std::string& code) {
+    std::istringstream stream(code);
+    return parseAsmStream(stream, "<buffer>");
+}
+
+Instruction decodeInstr(uint32_t word) {
+    int opcode = word >> 26;
+    int rs = (word >> 21) & 0x1F;
+    int rt = (word >> 16) & 0x1F;
+    int rd = (word >> 11) & 0x1F;
+    int funct6 = word & 0x3F;
+
+    const InstrInfo* found = nullptr;
+    for (const InstrInfo& info : ISA) {
+        if (info.opcode == opcode && (isIType(info) || info.funct6 == funct6)) {
+            found = &info;
+            break;
         }
     }
+    if (!found) {
+        throw std::runtime_error("Unknown encoding: opcode " + std::to_string(opcode) + ", funct " + std::to_string(funct6));
+    }
+
+    // fields in operand order
+    int fields[3] = {rd, rs, rt};
+    if (isIType(*found)) {
+        fields[0] = rt;
+        fields[1] = rs;
+        fields[2] = int16_t(word & 0xFFFF);
+    }
+    else if (onlyReads(found->op)) {
+        fields[0] = rs;
+        fields[1] = rt;
+    }
+
+    Instruction instr;
+    instr.op = found->op;
+    instr.name = found->name;
+    instr.num_of_ops = (int)std::strlen(found->operands);
+    Operand* ops[3] = {&instr.op1, &instr.op2, &instr.op3};
+    for (int i = 0; i < instr.num_of_ops; i++) {
+        char kind = found->operands[i];
+        if (kind == 'I') {
+            ops[i]->type = IMM;
+            ops[i]->value = fields[i];
+            continue;
+        }
+        // VRs have the top bit of the field set
+        bool is_vector = fields[i] >> 4;
+        if (is_vector != (kind == 'V') || (fields[i] & 0xF) >= SREG_SHAPE[0]) {
+            throw std::runtime_error(std::string("Bad register field ") + std::to_string(fields[i]) + " in " + found->name);
+        }
+        ops[i]->type = is_vector ? VECTOR : SCALAR;
+        ops[i]->value = fields[i] & 0xF;
+    }
+
+    return instr;
+}
 
+std::vector<Instruction> decodeBin(const uint32_t* words, size_t n) {
+    std::vector<Instruction> instrs;
+    for (size_t i = 0; i < n; i++) {
+        try {
+            instrs.push_back(decodeInstr(words[i]));
+        }
+        catch (const std::exception& e) {
+            throw std::runtime_error("Instr " + std::to_string(i) + ": " + e.what());
+        }
+    }
     return instrs;
-}
\ No newline at end of file
+}
+
+std::vector<Instruction> parseBin(const std::filesystem::path fp) {
+    std::ifstream file(fp, std::ios::binary);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Error opening file: " + fp.string());  // Throw exception on error
+    }
+
+    std::vector<uint32_t> words;
+    uint32_t word;
+    while (file.read(reinterpret_cast<char*>(&word), sizeof(word))) {
+        words.push_back(word);
+    }
+    if (file.gcount() != 0) {
+        throw std::runtime_error(fp.string() + " is not a whole number of 32 bit instrs");
+    }
+
+    return decodeBin(words.data(), words.size());
+}
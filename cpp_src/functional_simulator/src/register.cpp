@@ -1,26 +1,40 @@
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <stdexcept>
 #include "register.h"
 
 Register::Register(const int shape[2]) {
-    this->data = new int32_t*[shape[0]];
-    for (int i=0; i<shape[0]; i++) {
-        this->data[i] = new int32_t[shape[1]];
-    }
-
     this->shape[0] = shape[0];
     this->shape[1] = shape[1];
+    this->data.assign(shape[0] * shape[1], 0);
+};
+
+int32_t Register::read(int reg_num, int idx) const {
+    return this->data[reg_num * this->shape[1] + idx];
+};
+
+void Register::write(int reg_num, int idx, int32_t value) {
+    this->data[reg_num * this->shape[1] + idx] = value;
+};
+
+const int32_t* Register::row(int reg_num) const {
+    return this->data.data() + reg_num * this->shape[1];
 };
 
-int32_t Register::read(int reg_num, int idx) {
-    return this->data[reg_num][idx];
+int32_t* Register::row(int reg_num) {
+    return this->data.data() + reg_num * this->shape[1];
 };
 
-void Register::write(int reg_num, int idx, int value) {
-    this->data[reg_num][idx] = value;
+int Register::count() const {
+    return this->shape[0];
 };
 
-void Register::dump(const std::filesystem::path fp) {
+void Register::reset() {
+    std::fill(this->data.begin(), this->data.end(), 0);
+};
+
+void Register::dump(const std::filesystem::path fp) const {
     // Open the file for writing (it will overwrite if it exists)
     std::ofstream outFile(fp);
 
@@ -32,9 +46,9 @@ void Register::dump(const std::filesystem::path fp) {
     std::string tmp;
 
     // Write the data contents to the file
-    // Add reg nums
-    for (int i=0; i<shape[0]; i++) {
-        tmp = std::to_string(i);
+    // Add element nums
+    for (int j=0; j<shape[1]; j++) {
+        tmp = std::to_string(j);
         tmp.resize(MAX_COL_LEN, ' ');
         outFile << tmp;
     }
@@ -42,26 +56,19 @@ void Register::dump(const std::filesystem::path fp) {
     outFile << std::endl;
 
     // add seperating line
-    std::string sep_line(shape[0] * MAX_COL_LEN, '-');
+    std::string sep_line(shape[1] * MAX_COL_LEN, '-');
     outFile << sep_line << std::endl;
 
     // Add reg values
-    for (int j=0; j<shape[1]; j++) {
-        for (int i=0; i<shape[0]; i++) {
-            tmp = std::to_string(this->data[i][j]);
-            tmp.resize(MAX_COL_LEN, ' ');
+    for (int i=0; i<shape[0]; i++) {
+        for (int j=0; j<shape[1]; j++) {
+            tmp = std::to_string(this->read(i, j));
+            tmp.resize(std::max<size_t>(tmp.size(), MAX_COL_LEN), ' ');
             outFile << tmp;
         }
         outFile << std::endl;
     }
-    
+
     // Close the file
     outFile.close();
 };
-
-Register::~Register() {
-    for (int i=0; i<this->shape[0]; i++) {
-        delete[] this->data[i];
-    }
-    delete[] this->data;
-};
\ No newline at end of file
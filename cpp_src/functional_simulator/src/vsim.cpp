@@ -0,0 +1,189 @@
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include "vsim.h"
+#include "core.h"
+#include "parse_asm.h"
+
+struct vsim {
+    FunctionalSimulator sim;
+    mutable std::string error;
+};
+
+// runs f, turning exceptions into VSIM_ERROR and the message
+template <typename F>
+static int guard(const vsim* sim, F f) {
+    try {
+        f();
+        sim->error.clear();
+        return VSIM_OK;
+    }
+    catch (const std::exception& e) {
+        sim->error = e.what();
+        return VSIM_ERROR;
+    }
+}
+
+static Memory& memory(vsim* sim, int mem) {
+    if (mem == VSIM_SDMEM)
+        return sim->sim.sdmem();
+    if (mem == VSIM_VDMEM)
+        return sim->sim.vdmem();
+    throw std::invalid_argument("Unknown memory " + std::to_string(mem));
+}
+
+static void checkReg(int reg, int count) {
+    if (reg < 0 || reg >= count) {
+        throw std::out_of_range("Register " + std::to_string(reg) + " is outside 0-" + std::to_string(count - 1));
+    }
+}
+
+static void checkSize(size_t n) {
+    if (n > (size_t)INT32_MAX) {
+        throw std::out_of_range(std::to_string(n) + " words is too many");
+    }
+}
+
+extern "C" {
+
+vsim* vsim_create(void) {
+    // the constructor allocates the memories and registers, and exceptions must not cross the C API
+    try {
+        return new vsim();
+    }
+    catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void vsim_destroy(vsim* sim) {
+    delete sim;
+}
+
+const char* vsim_last_error(const vsim* sim) {
+    return sim->error.c_str();
+}
+
+int vsim_load_asm_file(vsim* sim, const char* path) {
+    return guard(sim, [&] { sim->sim.loadProgram(parseAsm(path)); });
+}
+
+int vsim_load_bin_file(vsim* sim, const char* path) {
+    return guard(sim, [&] { sim->sim.loadProgram(parseBin(path)); });
+}
+
+int vsim_load_asm(vsim* sim, const char* code) {
+    return guard(sim, [&] { sim->sim.loadProgram(parseAsmString(code)); });
+}
+
+int vsim_load_bin(vsim* sim, const uint32_t* words, size_t n_words) {
+    return guard(sim, [&] { sim->sim.loadProgram(decodeBin(words, n_words)); });
+}
+
+int vsim_load_mem_file(vsim* sim, int mem, const char* path) {
+    return guard(sim, [&] { memory(sim, mem).load(path); });
+}
+
+int vsim_map_mem_image(vsim* sim, int mem, const int32_t* image, size_t n_words) {
+    return guard(sim, [&] {
+        checkSize(n_words);
+        memory(sim, mem).loadImage(image, (int)n_words);
+    });
+}
+
+int vsim_map_mem(vsim* sim, int mem, int32_t* buffer, size_t n_words) {
+    return guard(sim, [&] {
+        checkSize(n_words);
+        memory(sim, mem).mapBuffer(buffer, (int)n_words);
+    });
+}
+
+int vsim_read_mem(vsim* sim, int mem, int32_t addr, int32_t* out, size_t n) {
+    return guard(sim, [&] {
+        checkSize(n);
+        Memory& m = memory(sim, mem);
+        for (size_t i = 0; i < n; i++)
+            out[i] = m.read(addr + (int32_t)i);
+    });
+}
+
+int vsim_write_mem(vsim* sim, int mem, int32_t addr, const int32_t* values, size_t n) {
+    return guard(sim, [&] {
+        checkSize(n);
+        Memory& m = memory(sim, mem);
+        for (size_t i = 0; i < n; i++)
+            m.write(addr + (int32_t)i, values[i]);
+    });
+}
+
+size_t vsim_mem_size(vsim* sim, int mem) {
+    size_t size = 0;
+    guard(sim, [&] { size = memory(sim, mem).getSize(); });
+    return size;
+}
+
+void vsim_reset(vsim* sim) {
+    sim->sim.reset();
+    sim->error.clear();
+}
+
+int vsim_step(vsim* sim) {
+    bool running = true;
+    int status = guard(sim, [&] { running = sim->sim.step(); });
+    return status == VSIM_OK && !running ? VSIM_HALTED : status;
+}
+
+int vsim_run(vsim* sim, uint64_t max_instrs) {
+    int status = guard(sim, [&] { sim->sim.run(max_instrs); });
+    if (status != VSIM_OK)
+        return status;
+    return sim->sim.isHalted() ? VSIM_HALTED : VSIM_RUNNING;
+}
+
+uint64_t vsim_instr_count(const vsim* sim) {
+    return sim->sim.getInstrCount();
+}
+
+int32_t vsim_pc(const vsim* sim) {
+    return sim->sim.getPc();
+}
+
+int vsim_read_sreg(const vsim* sim, int reg, int32_t* out) {
+    return guard(sim, [&] {
+        checkReg(reg, sim->sim.sreg().count());
+        *out = sim->sim.sreg().read(reg, 0);
+    });
+}
+
+int vsim_write_sreg(vsim* sim, int reg, int32_t value) {
+    return guard(sim, [&] {
+        checkReg(reg, sim->sim.sreg().count());
+        if (reg == 0)
+            throw std::invalid_argument("SR0 is always 0");
+        sim->sim.sreg().write(reg, 0, value);
+    });
+}
+
+int vsim_read_vreg(const vsim* sim, int reg, int32_t out[64]) {
+    return guard(sim, [&] {
+        checkReg(reg, sim->sim.vreg().count());
+        const int32_t* row = sim->sim.vreg().row(reg);
+        std::copy(row, row + MAX_VECTOR_LEN, out);
+    });
+}
+
+int32_t vsim_vlen(const vsim* sim) {
+    return sim->sim.getVlen();
+}
+
+int32_t vsim_ew(const vsim* sim) {
+    return sim->sim.getEw();
+}
+
+int vsim_read_vmask(const vsim* sim, uint8_t out[256]) {
+    int n = sim->sim.mvl();
+    std::copy(sim->sim.vectorMask(), sim->sim.vectorMask() + n, out);
+    return n;
+}
+
+}
@@ -0,0 +1,46 @@
+#!/bin/bash
+# Runs a workload through the Python functional simulator and func_sim, with
+# full and delta memory dumps, and checks that they write the same files.
+#
+#     test/compare_python.sh <func_sim> <workload dir>
+#
+# The workload is copied to a temp dir, so its outputs aren't touched.
+set -e
+
+if [ $# -ne 2 ]; then
+    echo "Usage: $0 <func_sim> <workload dir>"
+    exit 1
+fi
+func_sim=$(realpath "$1")
+workload=$(realpath "$2")
+python_src=$(realpath "$(dirname "$0")/../../../python_src")
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+failures=0
+for dump in full delta; do
+    cp -r "$workload" "$tmp/py_$dump"
+    cp -r "$workload" "$tmp/cpp_$dump"
+    # the Python simulator logs to out.txt in the working dir
+    (cd "$tmp" && python3 "$python_src/funcsimulator.py" --iodir "$tmp/py_$dump" --dump $dump > /dev/null)
+    "$func_sim" "$tmp/cpp_$dump" --dump $dump > /dev/null
+
+    if [ $dump = full ]; then
+        files="VRF.txt SRF.txt SDMEMOP.txt VDMEMOP.txt"
+    else
+        files="VRF.txt SRF.txt SDMEMOP.delta.txt VDMEMOP.delta.txt"
+    fi
+    for f in $files; do
+        if ! cmp -s "$tmp/py_$dump/$f" "$tmp/cpp_$dump/$f"; then
+            echo "$f differs with --dump $dump:"
+            diff "$tmp/py_$dump/$f" "$tmp/cpp_$dump/$f" | head -5
+            failures=$((failures + 1))
+        fi
+    done
+done
+
+if [ $failures -ne 0 ]; then
+    echo "$failures outputs differ"
+    exit 1
+fi
+echo "Python and C++ outputs match on $(basename "$workload")"
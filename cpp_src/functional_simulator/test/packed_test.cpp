@@ -0,0 +1,124 @@
+/*
+Tests the packed element helpers in include/packed.h against plain 64 bit
+reference loops, at every element width and at vector lengths that aren't a
+whole block.
+
+    make test
+
+Prints each failed check and exits with 1 if there were any.
+*/
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "common.h"
+#include "packed.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #cond);  \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+static std::mt19937 rng(1);
+
+// n random ew bit elements, with the extremes mixed in so ops overflow
+static std::vector<int32_t> randomElems(int n, int ew) {
+    std::uniform_int_distribution<int64_t> dist(-(int64_t(1) << (ew - 1)), (int64_t(1) << (ew - 1)) - 1);
+    std::vector<int32_t> elems(n);
+    for (int32_t& e : elems)
+        e = int32_t(dist(rng));
+    elems[0] = int32_t(-(int64_t(1) << (ew - 1)));
+    elems[1] = int32_t((int64_t(1) << (ew - 1)) - 1);
+    return elems;
+}
+
+static std::vector<uint8_t> randomMask(int n) {
+    std::vector<uint8_t> mask(n);
+    for (uint8_t& m : mask)
+        m = rng() % 4 != 0;
+    return mask;
+}
+
+static void testOp(PackedOp op, int ew, int n) {
+    std::vector<int32_t> a = randomElems(MAX_LANES, ew), b = randomElems(MAX_LANES, ew);
+    std::vector<int32_t> dst = randomElems(MAX_LANES, ew), expected = dst;
+    std::vector<uint8_t> mask = randomMask(MAX_LANES);
+    for (int i = 0; i < n; i++) {
+        int64_t x = a[i], y = b[i];
+        int64_t res = op == PACKED_ADD ? x + y : op == PACKED_SUB ? x - y : x * y;
+        if (mask[i])
+            expected[i] = wrapElem(res, ew);
+    }
+
+    packedOp(op, a.data(), b.data(), dst.data(), n, ew, mask.data());
+    CHECK(dst == expected);
+}
+
+static void testMacw(int ew, int n) {
+    int k = 32 / ew;
+    std::vector<int32_t> a = randomElems(MAX_LANES, ew), b = randomElems(MAX_LANES, ew);
+    std::vector<int32_t> acc = randomElems(MAX_VECTOR_LEN, 32), expected = acc;
+    std::vector<uint8_t> mask = randomMask(MAX_LANES);
+    for (int i = 0; i < n; i++) {
+        if (mask[i])
+            expected[i / k] = wrapElem(int64_t(expected[i / k]) + int64_t(a[i]) * b[i], 32);
+    }
+
+    packedMacw(a.data(), b.data(), acc.data(), n, ew, mask.data());
+    CHECK(acc == expected);
+}
+
+static void testNarrow(int ew, int n) {
+    int k = 32 / ew;
+    std::vector<int32_t> src = randomElems(MAX_VECTOR_LEN, 32);
+    std::vector<int32_t> dst = randomElems(MAX_LANES, ew), expected = dst;
+    std::vector<uint8_t> mask = randomMask(MAX_LANES);
+    int n_out = (n + k - 1) / k;
+    for (int i = 0; i < n_out; i++) {
+        if (mask[i])
+            expected[i] = saturateElem(src[i], ew);
+    }
+
+    CHECK(packedNarrow(src.data(), n, ew, dst.data(), mask.data()) == n_out);
+    CHECK(dst == expected);
+}
+
+static void testPackWords() {
+    for (int ew : ELEMENT_WIDTHS) {
+        int k = 32 / ew;
+        std::vector<int32_t> elems = randomElems(MAX_LANES, ew);
+        std::vector<int32_t> words(MAX_VECTOR_LEN), unpacked(MAX_LANES);
+        packWords(elems.data(), MAX_VECTOR_LEN, ew, words.data());
+        unpackWords(words.data(), MAX_VECTOR_LEN, ew, unpacked.data());
+        CHECK(std::equal(elems.begin(), elems.begin() + MAX_VECTOR_LEN * k, unpacked.begin()));
+        CHECK(getElem(words[1], k - 1, ew) == elems[2 * k - 1]);
+    }
+    CHECK(setElem(0, 1, -1, 8) == 0xFF00);
+    CHECK(wrapElem(128, 8) == -128);
+    CHECK(saturateElem(-129, 8) == -128);
+    CHECK(saturateElem(int64_t(1) << 40, 32) == INT32_MAX);
+}
+
+int main() {
+    for (int ew : ELEMENT_WIDTHS) {
+        int mvl = MAX_VECTOR_LEN * 32 / ew;
+        for (int n : {0, 1, 3, 17, 63, mvl - 5, mvl}) {
+            for (PackedOp op : {PACKED_ADD, PACKED_SUB, PACKED_MUL})
+                testOp(op, ew, n);
+            testMacw(ew, n);
+            testNarrow(ew, n);
+        }
+    }
+    testPackWords();
+
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+Tests the C API in include/vsim.h on dot_product and on small programs.
+
+    make test
+    ./vsim_test ../../dot_product
+
+Prints each failed check and exits with 1 if there were any.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vsim.h"
+
+#define VDMEM_WORDS 4096 // dot_product saves its result at 2048
+#define RESULT_ADDR 2048
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #cond);  \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+// the error of the last call contains msg
+#define CHECK_ERROR(sim, msg) CHECK(strstr(vsim_last_error(sim), msg) != NULL)
+
+// one word per line, like SDMEM.txt, into buf[0, max), returns the words read
+static size_t readWords(const char* dir, const char* name, int32_t* buf, size_t max) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        printf("Error opening file: %s\n", path);
+        exit(1);
+    }
+    size_t n = 0;
+    while (n < max && fscanf(file, "%d", &buf[n]) == 1)
+        n++;
+    fclose(file);
+    return n;
+}
+
+// dot product of the two vectors laid out as SDMEM says, computed on the host
+static int32_t expectedDot(const int32_t* sdmem, const int32_t* vdmem) {
+    uint32_t sum = 0; // wraps around at 32 bits like the simulator
+    for (int32_t i = 0; i < sdmem[1]; i++)
+        sum += (uint32_t)vdmem[i] * (uint32_t)vdmem[sdmem[1] + i];
+    return (int32_t)sum;
+}
+
+// runs dot_product in a buffer mapped with vsim_map_mem
+static void testMappedBuffer(const char* dir, const int32_t* sdmem, size_t n_sdmem, const int32_t* vdmem) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/Code.asm", dir);
+    int32_t* buffer = calloc(VDMEM_WORDS, sizeof(int32_t));
+    memcpy(buffer, vdmem, VDMEM_WORDS * sizeof(int32_t));
+
+    vsim* sim = vsim_create();
+    CHECK(sim != NULL);
+    CHECK(vsim_load_asm_file(sim, path) == VSIM_OK);
+    CHECK(vsim_map_mem_image(sim, VSIM_SDMEM, sdmem, n_sdmem) == VSIM_OK);
+    CHECK(vsim_map_mem(sim, VSIM_VDMEM, buffer, VDMEM_WORDS) == VSIM_OK);
+    CHECK(vsim_mem_size(sim, VSIM_VDMEM) == VDMEM_WORDS);
+
+    CHECK(vsim_run(sim, 0) == VSIM_HALTED);
+    CHECK(buffer[RESULT_ADDR] == expectedDot(sdmem, vdmem));
+    int32_t result = 0;
+    CHECK(vsim_read_mem(sim, VSIM_VDMEM, RESULT_ADDR, &result, 1) == VSIM_OK);
+    CHECK(result == buffer[RESULT_ADDR]);
+    int32_t sr1 = 0;
+    CHECK(vsim_read_sreg(sim, 1, &sr1) == VSIM_OK);
+    CHECK(sr1 == RESULT_ADDR);
+
+    // addresses past the mapped buffer are out of range
+    CHECK(vsim_read_mem(sim, VSIM_VDMEM, VDMEM_WORDS, &result, 1) == VSIM_ERROR);
+    CHECK_ERROR(sim, "Invalid memory access at address: 4096");
+    CHECK(vsim_read_mem(sim, VSIM_VDMEM, VDMEM_WORDS - 1, &result, 2) == VSIM_ERROR);
+    CHECK(vsim_write_mem(sim, VSIM_VDMEM, -1, &result, 1) == VSIM_ERROR);
+    CHECK(vsim_read_mem(sim, 2, 0, &result, 1) == VSIM_ERROR);
+    CHECK_ERROR(sim, "Unknown memory 2");
+
+    vsim_destroy(sim);
+    free(buffer);
+}
+
+// runs dot_product over a shared image, resets and runs it again
+static void testReset(const char* dir, const int32_t* sdmem, size_t n_sdmem, const int32_t* vdmem) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/Code.asm", dir);
+
+    vsim* sim = vsim_create();
+    CHECK(vsim_load_asm_file(sim, path) == VSIM_OK);
+    CHECK(vsim_map_mem_image(sim, VSIM_SDMEM, sdmem, n_sdmem) == VSIM_OK);
+    CHECK(vsim_map_mem_image(sim, VSIM_VDMEM, vdmem, VDMEM_WORDS) == VSIM_OK);
+
+    CHECK(vsim_run(sim, 0) == VSIM_HALTED);
+    uint64_t count = vsim_instr_count(sim);
+    int32_t result = 0;
+    CHECK(vsim_read_mem(sim, VSIM_VDMEM, RESULT_ADDR, &result, 1) == VSIM_OK);
+    CHECK(result == expectedDot(sdmem, vdmem));
+    CHECK(vdmem[RESULT_ADDR] == 0); // the image is never written
+    CHECK(vsim_step(sim) == VSIM_HALTED);
+
+    vsim_reset(sim);
+    CHECK(vsim_pc(sim) == 0);
+    CHECK(vsim_instr_count(sim) == 0);
+    CHECK(vsim_vlen(sim) == 64);
+    CHECK(vsim_ew(sim) == 32);
+    int32_t sr1 = -1;
+    CHECK(vsim_read_sreg(sim, 1, &sr1) == VSIM_OK);
+    CHECK(sr1 == 0);
+    CHECK(vsim_read_mem(sim, VSIM_VDMEM, RESULT_ADDR, &result, 1) == VSIM_OK);
+    CHECK(result == 0);
+
+    // a few instrs at a time gives the same result
+    int status;
+    while ((status = vsim_run(sim, 10)) == VSIM_RUNNING)
+        ;
+    CHECK(status == VSIM_HALTED);
+    CHECK(vsim_instr_count(sim) == count);
+    CHECK(vsim_read_mem(sim, VSIM_VDMEM, RESULT_ADDR, &result, 1) == VSIM_OK);
+    CHECK(result == expectedDot(sdmem, vdmem));
+
+    vsim_destroy(sim);
+}
+
+static void testBadRegister(void) {
+    vsim* sim = vsim_create();
+    int32_t value = 7;
+    CHECK(vsim_read_sreg(sim, 8, &value) == VSIM_ERROR);
+    CHECK_ERROR(sim, "Register 8 is outside 0-7");
+    CHECK(value == 7); // not written on errors
+    CHECK(vsim_read_sreg(sim, -1, &value) == VSIM_ERROR);
+    CHECK(vsim_write_sreg(sim, 0, 1) == VSIM_ERROR);
+    CHECK_ERROR(sim, "SR0");
+
+    int32_t vreg[64];
+    CHECK(vsim_read_vreg(sim, 8, vreg) == VSIM_ERROR);
+    CHECK(vsim_read_vreg(sim, 1, vreg) == VSIM_OK);
+    CHECK(vsim_last_error(sim)[0] == '\0');
+
+    // and in a program
+    CHECK(vsim_load_asm(sim, "ADD SR1 SR2 SR8\nHALT\n") == VSIM_ERROR);
+    CHECK_ERROR(sim, "Expected SR0-SR7, got SR8");
+
+    vsim_destroy(sim);
+}
+
+static void testUnknownInstruction(void) {
+    vsim* sim = vsim_create();
+    CHECK(vsim_load_asm(sim, "# comment\nFOO SR1\nHALT\n") == VSIM_ERROR);
+    CHECK_ERROR(sim, "<buffer>:2: Unknown instruction: FOO");
+
+    uint32_t word = 0xFFFFFFC0; // opcode of HALT with funct 0
+    CHECK(vsim_load_bin(sim, &word, 1) == VSIM_ERROR);
+    CHECK_ERROR(sim, "Unknown encoding");
+
+    vsim_destroy(sim);
+}
+
+// 1 << 30 + 1 << 30 wraps around, and a load past SDMEM stops the run
+static void testProgram(void) {
+    vsim* sim = vsim_create();
+    int32_t big = 1 << 30;
+    CHECK(vsim_write_mem(sim, VSIM_SDMEM, 0, &big, 1) == VSIM_OK);
+    CHECK(vsim_load_asm(sim, "LS SR1 SR0 0\nADD SR2 SR1 SR1\nLS SR3 SR0 9000\nHALT\n") == VSIM_OK);
+    CHECK(vsim_step(sim) == VSIM_OK);
+    CHECK(vsim_step(sim) == VSIM_OK);
+    int32_t sr2 = 0;
+    CHECK(vsim_read_sreg(sim, 2, &sr2) == VSIM_OK);
+    CHECK(sr2 == (int32_t)0x80000000);
+    CHECK(vsim_run(sim, 0) == VSIM_ERROR);
+    CHECK_ERROR(sim, "PC 2 (LS)");
+    CHECK(vsim_pc(sim) == 2);
+    vsim_destroy(sim);
+}
+
+int main(int argc, char* argv[]) {
+    const char* dir = argc > 1 ? argv[1] : "../../dot_product";
+    int32_t sdmem[16] = {0};
+    int32_t* vdmem = calloc(VDMEM_WORDS, sizeof(int32_t));
+    size_t n_sdmem = readWords(dir, "SDMEM.txt", sdmem, 16);
+    readWords(dir, "VDMEM.txt", vdmem, VDMEM_WORDS);
+
+    testMappedBuffer(dir, sdmem, n_sdmem, vdmem);
+    testReset(dir, sdmem, n_sdmem, vdmem);
+    testBadRegister();
+    testUnknownInstruction();
+    testProgram();
+
+    free(vdmem);
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include "scheduler.h"
+
+// A generated workload: the program and the SDMEM/VDMEM images it expects
+struct Kernel {
+    std::vector<std::string> header; // comment lines at the top of Code.asm
+    std::vector<AsmInstr> code;
+    std::vector<int32_t> sdmem, vdmem;
+    int out_addr = 0;                // VDMEM addr of the output
+    std::vector<int32_t> expected;   // output words computed on the host
+};
+
+struct DotShape {
+    int n;       // elements per vector
+    int ew = 32; // element width, 8 and 16 are packed
+};
+
+struct ConvShape {
+    int rows, cols; // input matrix
+    int kernel;     // kernel is kernel x kernel
+    int stride = 1;
+    int pad = 0;    // zero rows/cols on each side
+};
+
+struct FcShape {
+    int in, out;
+};
+
+// Each generator strip-mines the vectors into MVL sized strips (the last one
+// shorter, with MTCL), picks the register blocking and unroll factor that the
+// assembler's timing model says is fastest for config, and list schedules the result.
+// Inputs are random ints from seed, small enough that nothing overflows
+Kernel generateDot(const DotShape& shape, const MachineConfig& config, unsigned seed);
+Kernel generateConv(const ConvShape& shape, const MachineConfig& config, unsigned seed);
+Kernel generateFc(const FcShape& shape, const MachineConfig& config, unsigned seed);
+
+// Code.asm, SDMEM.txt, VDMEM.txt and Expected.txt ("addr value" per output word)
+void saveKernel(const Kernel& kernel, const std::filesystem::path iodir);
+
+#endif
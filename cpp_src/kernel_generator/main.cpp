@@ -0,0 +1,115 @@
+#include <iostream>
+#include <map>
+#include <functional>
+#include "kernels.h"
+
+static void generate(const std::string& kind, const std::filesystem::path& iodir, const std::filesystem::path& config_fp,
+                     const std::function<int(const std::string&, int)>& get);
+
+static void usage(const char* exec) {
+    std::cerr << "Usage: " << exec << " <dot|conv|fc> <iodir> [--config <Config.txt>] [--seed <N>] <shape>\n"
+              << "  dot:  --n <elements> [--ew 8|16|32]\n"
+              << "  conv: --rows <N> --cols <N> --kernel <N> [--stride <N>] [--pad <N>]\n"
+              << "  fc:   --in <N> --out <N>\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string kind = argv[1];
+    std::filesystem::path iodir = argv[2];
+    std::filesystem::path config_fp = iodir / "Config.txt";
+    std::map<std::string, int> opts;
+
+    for (int i = 3; i < argc; i += 2) {
+        std::string opt = argv[i];
+        if (opt.rfind("--", 0) != 0) {
+            std::cerr << "Unknown option: " << opt << "\n";
+            return 1;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << opt << "\n";
+            return 1;
+        }
+        if (opt == "--config")
+            config_fp = argv[i + 1];
+        else {
+            try {
+                size_t end;
+                opts[opt.substr(2)] = std::stoi(argv[i + 1], &end);
+                if (argv[i + 1][end] != '\0')
+                    throw std::invalid_argument(argv[i + 1]);
+            }
+            catch (const std::exception&) {
+                std::cerr << opt << " must be a number, got " << argv[i + 1] << "\n";
+                return 1;
+            }
+        }
+    }
+
+    // shape options that weren't given
+    auto get = [&](const std::string& key, int default_value) {
+        auto it = opts.find(key);
+        return it == opts.end() ? default_value : it->second;
+    };
+    std::vector<std::string> required = kind == "dot"  ? std::vector<std::string>{"n"} :
+                                        kind == "conv" ? std::vector<std::string>{"rows", "cols", "kernel"} :
+                                        kind == "fc"   ? std::vector<std::string>{"in", "out"} :
+                                                         std::vector<std::string>{};
+    if (required.empty()) {
+        std::cerr << "Unknown kernel: " << kind << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+    for (const std::string& key : required) {
+        if (!opts.count(key)) {
+            std::cerr << "Missing option: --" << key << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        generate(kind, iodir, config_fp, get);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static void generate(const std::string& kind, const std::filesystem::path& iodir, const std::filesystem::path& config_fp,
+                     const std::function<int(const std::string&, int)>& get) {
+    // the blocking is tuned to the pipeline depths in Config.txt, the defaults if there is none
+    MachineConfig config;
+    if (std::filesystem::exists(config_fp))
+        config = readConfig(config_fp);
+    else
+        std::cout << "No " << config_fp.string() << ", tuning for the default config" << std::endl;
+
+    unsigned seed = get("seed", 0);
+    Kernel kernel;
+    if (kind == "dot")
+        kernel = generateDot({get("n", 0), get("ew", 32)}, config, seed);
+    else if (kind == "conv")
+        kernel = generateConv({get("rows", 0), get("cols", 0), get("kernel", 0), get("stride", 1), get("pad", 0)}, config, seed);
+    else
+        kernel = generateFc({get("in", 0), get("out", 0)}, config, seed);
+
+    std::filesystem::create_directories(iodir);
+    saveKernel(kernel, iodir);
+
+    // the simulators read Config.txt from the iodir
+    std::filesystem::path iodir_config = iodir / "Config.txt";
+    if (std::filesystem::exists(config_fp) && !std::filesystem::exists(iodir_config))
+        std::filesystem::copy_file(config_fp, iodir_config);
+
+    for (const std::string& line : kernel.header)
+        std::cout << line << std::endl;
+    std::cout << "Saved Code.asm (" << kernel.code.size() << " instrs), SDMEM.txt, VDMEM.txt and Expected.txt in "
+              << iodir.string() << std::endl;
+}
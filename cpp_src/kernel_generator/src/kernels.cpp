@@ -0,0 +1,572 @@
+#include <fstream>
+#include <random>
+#include <map>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+#include "kernels.h"
+
+const int MAX_VECTOR_LEN = 64;
+const int REG_BITS = 32;
+const int NUM_VREGS = 7;       // VR1-VR7, VR0 is always 0
+const int SDMEM_SIZE = 1 << 13; // words, 32 KB
+const int VDMEM_SIZE = 1 << 17; // words, 512 KB
+const int MAX_UNROLL = 4;
+
+static std::string vr(int i) {
+    return "VR" + std::to_string(i);
+}
+
+// "1 strip", "2 strips"
+static std::string count(int n, const std::string& noun) {
+    return std::to_string(n) + " " + noun + (n == 1 ? "" : "s");
+}
+
+// ---- Program builder ----
+
+// Emits instrs, constants are loaded with LS from SDMEM words added after the kernel's data
+class Emitter {
+private:
+    std::vector<int32_t>& sdmem;
+    std::map<int32_t, int> consts; // value -> SDMEM addr
+public:
+    std::vector<AsmInstr> code;
+
+    Emitter(std::vector<int32_t>& sdmem) : sdmem(sdmem) {}
+
+    void op(const std::string& name, const std::string& a = "", const std::string& b = "",
+            const std::string& c = "", const std::string& comment = "") {
+        code.push_back({{name, a, b, c}, comment});
+    }
+
+    // sr = value
+    void li(const std::string& sr, int32_t value, const std::string& comment = "") {
+        auto it = consts.find(value);
+        if (it == consts.end()) {
+            it = consts.emplace(value, (int)sdmem.size()).first;
+            sdmem.push_back(value);
+        }
+        op("LS", sr, "SR0", std::to_string(it->second), comment.empty() ? sr + " = " + std::to_string(value) : comment);
+    }
+
+    int here() const {
+        return (int)code.size();
+    }
+
+    // branch back to the instr at top
+    void loop(const std::string& name, const std::string& a, const std::string& b, int top, const std::string& comment) {
+        op(name, a, b, std::to_string(top - here()), comment);
+    }
+};
+
+// ---- Tuning ----
+
+// Steady state cycles per unit of work of a loop body, the timing model's
+// cycles for two bodies back to back minus the cycles for one
+static double bodyCycles(const std::function<void(Emitter&)>& body, const MachineConfig& config, int work) {
+    std::vector<int32_t> scratch;
+    Emitter one(scratch), two(scratch);
+    body(one);
+    body(two);
+    body(two);
+    return double(blockCycles(two.code, config) - blockCycles(one.code, config)) / work;
+}
+
+// keeps the candidate with the fewest cycles, the first one on ties
+template <typename T>
+struct Best {
+    T blocking;
+    double cycles = std::numeric_limits<double>::max();
+
+    void consider(const T& candidate, double c) {
+        if (c < cycles) {
+            blocking = candidate;
+            cycles = c;
+        }
+    }
+};
+
+// output cols/elements split into blocks of up to strips_per_block full strips,
+// a last shorter strip gets a block of its own since it needs its own MTCL
+struct StripBlock {
+    int first;  // first element
+    int strips;
+    int width;  // elements per strip
+};
+
+static std::vector<StripBlock> stripBlocks(int n, int strips_per_block) {
+    std::vector<StripBlock> blocks;
+    int full = n / MAX_VECTOR_LEN;
+    for (int s = 0; s < full; s += strips_per_block)
+        blocks.push_back({s * MAX_VECTOR_LEN, std::min(strips_per_block, full - s), MAX_VECTOR_LEN});
+    if (n % MAX_VECTOR_LEN)
+        blocks.push_back({full * MAX_VECTOR_LEN, 1, n % MAX_VECTOR_LEN});
+    return blocks;
+}
+
+static void checkSizes(const Kernel& kernel) {
+    if ((int)kernel.sdmem.size() > SDMEM_SIZE)
+        throw std::runtime_error("SDMEM needs " + std::to_string(kernel.sdmem.size()) + " words, only " +
+                                 std::to_string(SDMEM_SIZE) + " available");
+    int vdmem_end = std::max((int)kernel.vdmem.size(), kernel.out_addr + (int)kernel.expected.size());
+    if (vdmem_end > VDMEM_SIZE)
+        throw std::runtime_error("VDMEM needs " + std::to_string(vdmem_end) + " words, only " +
+                                 std::to_string(VDMEM_SIZE) + " available");
+}
+
+static std::vector<int32_t> randomInts(std::mt19937& rng, int n) {
+    std::uniform_int_distribution<int32_t> dist(-128, 127);
+    std::vector<int32_t> values(n);
+    for (int32_t& v : values)
+        v = dist(rng);
+    return values;
+}
+
+// ---- Dot product ----
+
+struct DotBlocking {
+    int unroll; // strips per loop iteration
+    int pairs;  // register pairs the strips load into, in turn
+    int accs;   // accumulators, in turn
+};
+
+// count strips, each loads a and b and multiply accumulates them into
+// an accumulator (MACW, a plain multiply accumulate at 32 bit elements)
+static void dotStrips(Emitter& e, const DotBlocking& b, int count) {
+    for (int c = 0; c < count; c++) {
+        std::string va = vr(b.accs + 1 + 2 * (c % b.pairs)), vb = vr(b.accs + 2 + 2 * (c % b.pairs));
+        e.op("LV", va, "SR1");
+        e.op("LV", vb, "SR2");
+        e.op("MACW", vr(1 + c % b.accs), va, vb);
+        e.op("ADD", "SR1", "SR1", "SR4");
+        e.op("ADD", "SR2", "SR2", "SR4");
+    }
+}
+
+Kernel generateDot(const DotShape& shape, const MachineConfig& config, unsigned seed) {
+    if (shape.n < 1)
+        throw std::runtime_error("dot product needs at least 1 element");
+    if (shape.ew != 8 && shape.ew != 16 && shape.ew != 32)
+        throw std::runtime_error("element width must be 8, 16 or 32");
+
+    int k = REG_BITS / shape.ew; // elements per word
+    int mvl = MAX_VECTOR_LEN * k;
+    int words = (shape.n + k - 1) / k;
+
+    Kernel kernel;
+    std::mt19937 rng(seed);
+    std::vector<int32_t> a = randomInts(rng, shape.n), b = randomInts(rng, shape.n);
+    int64_t dot = 0;
+    for (int i = 0; i < shape.n; i++)
+        dot += int64_t(a[i]) * b[i];
+
+    // element i of a vector is in word i / k, bits (i % k) * ew and up
+    for (const std::vector<int32_t>* vec : {&a, &b}) {
+        for (int w = 0; w < words; w++) {
+            uint32_t word = 0;
+            for (int lane = 0; lane < k && w * k + lane < shape.n; lane++)
+                word |= (uint32_t((*vec)[w * k + lane]) & uint32_t((uint64_t(1) << shape.ew) - 1)) << (lane * shape.ew);
+            kernel.vdmem.push_back(int32_t(word));
+        }
+    }
+    kernel.out_addr = 2 * words;
+    kernel.expected = {int32_t(dot)};
+
+    Best<DotBlocking> best;
+    for (int u = 1; u <= MAX_UNROLL; u++) {
+        for (int p = 1; p <= u; p++) {
+            for (int acc = 1; acc <= u && 2 * p + acc <= NUM_VREGS; acc++) {
+                DotBlocking cand = {u, p, acc};
+                best.consider(cand, bodyCycles([&](Emitter& e) { dotStrips(e, cand, u); }, config, u));
+            }
+        }
+    }
+    const DotBlocking& blk = best.blocking;
+
+    Emitter e(kernel.sdmem);
+    int full = shape.n / mvl, tail = shape.n % mvl;
+
+    e.li("SR4", MAX_VECTOR_LEN, "SR4 = words per strip");
+    if (shape.ew != REG_BITS) {
+        e.li("SR5", shape.ew);
+        e.op("MTEW", "SR5", "", "", std::to_string(shape.ew) + " bit elements, vector len = " + std::to_string(mvl));
+    }
+    e.li("SR1", 0, "SR1 = a");
+    e.li("SR2", words, "SR2 = b");
+
+    // strips that don't fill a loop iteration go first
+    dotStrips(e, blk, full % blk.unroll);
+    if (full >= blk.unroll) {
+        e.li("SR3", full * MAX_VECTOR_LEN, "SR3 = end of the full strips of a");
+        int top = e.here();
+        dotStrips(e, blk, blk.unroll);
+        e.loop("BNE", "SR1", "SR3", top, "loop over " + count(blk.unroll, "strip") + " at a time");
+    }
+    if (tail) {
+        e.li("SR5", tail);
+        e.op("MTCL", "SR5", "", "", "last strip is " + std::to_string(tail) + " elements");
+        dotStrips(e, blk, 1);
+    }
+
+    // sum the accumulators, then halve the vector 6 times with PACKLO/PACKHI
+    if (shape.ew != REG_BITS) {
+        e.li("SR5", REG_BITS);
+        e.op("MTEW", "SR5", "", "", "back to 32 bit elements, vector len = 64");
+    }
+    else if (tail) {
+        e.li("SR5", MAX_VECTOR_LEN);
+        e.op("MTCL", "SR5", "", "", "vector len = 64");
+    }
+    for (int acc = 2; acc <= blk.accs; acc++)
+        e.op("ADDVV", "VR1", "VR1", vr(acc));
+    for (int half = MAX_VECTOR_LEN / 2; half >= 1; half /= 2) {
+        e.op("PACKLO", "VR6", "VR1", "VR0");
+        e.op("PACKHI", "VR7", "VR1", "VR0");
+        e.op("ADDVV", "VR1", "VR6", "VR7", "sum of pairs, " + std::to_string(half) + " partial sums left");
+    }
+    e.li("SR5", 1);
+    e.op("MTCL", "SR5", "", "", "only store element 0");
+    e.li("SR6", kernel.out_addr);
+    e.op("SV", "VR1", "SR6");
+    e.op("HALT");
+
+    kernel.code = scheduleProgram(e.code, config, 1, {});
+    kernel.header = {
+        "Dot product of 2 vectors of " + std::to_string(shape.n) + " " + std::to_string(shape.ew) + " bit elements",
+        "a is at VDMEM 0, b at VDMEM " + std::to_string(words) + ", the result is saved at VDMEM " + std::to_string(kernel.out_addr),
+    };
+    if (k > 1)
+        kernel.header.push_back(std::to_string(k) + " elements per word, element 0 in the low bits");
+    kernel.header.push_back("blocking: " + count(blk.unroll, "strip") + " per loop iteration, " +
+                            count(blk.pairs, "load register pair") + ", " + count(blk.accs, "accumulator"));
+    checkSizes(kernel);
+    return kernel;
+}
+
+// ---- Fully connected layer ----
+
+struct FcBlocking {
+    int strips; // output strips per block, each has an accumulator
+    int temps;  // registers the weights are loaded into, in turn
+    int unroll; // inputs per loop iteration
+};
+
+// count inputs, each is x[i] times row i of the block's weights added to the
+// accumulators. x[i + c] is at SR1 + c in SDMEM, and the weights are laid out in
+// the order they are loaded so SR2 just moves on by a strip (SR6) after each load
+static void fcInputs(Emitter& e, const FcBlocking& b, int strips, int count) {
+    for (int c = 0; c < count; c++) {
+        std::string x = c % 2 ? "SR7" : "SR5";
+        e.op("LS", x, "SR1", std::to_string(c), x + " = x[i + " + std::to_string(c) + "]");
+        for (int s = 0; s < strips; s++) {
+            std::string t = vr(b.strips + 1 + (c * strips + s) % b.temps);
+            e.op("LV", t, "SR2");
+            e.op("ADD", "SR2", "SR2", "SR6");
+            e.op("MULVS", t, t, x);
+            e.op("ADDVV", vr(1 + s), vr(1 + s), t);
+        }
+    }
+}
+
+Kernel generateFc(const FcShape& shape, const MachineConfig& config, unsigned seed) {
+    if (shape.in < 1 || shape.out < 1)
+        throw std::runtime_error("fully connected layer needs at least 1 input and 1 output");
+
+    Kernel kernel;
+    std::mt19937 rng(seed);
+    std::vector<int32_t> x = randomInts(rng, shape.in);
+    std::vector<int32_t> w = randomInts(rng, shape.in * shape.out); // w[o * in + i]
+    std::vector<int32_t> bias = randomInts(rng, shape.out);
+
+    for (int o = 0; o < shape.out; o++) {
+        int64_t y = bias[o];
+        for (int i = 0; i < shape.in; i++)
+            y += int64_t(w[o * shape.in + i]) * x[i];
+        kernel.expected.push_back(int32_t(y));
+    }
+
+    int full = shape.out / MAX_VECTOR_LEN;
+    Best<FcBlocking> best;
+    for (int s = 1; s <= std::max(full, 1) && s < NUM_VREGS; s++) {
+        for (int t = 1; s + t <= NUM_VREGS; t++) {
+            for (int u = 1; u <= MAX_UNROLL; u++) {
+                FcBlocking cand = {s, t, u};
+                best.consider(cand, bodyCycles([&](Emitter& e) { fcInputs(e, cand, s, u); }, config, s * u));
+            }
+        }
+    }
+    const FcBlocking& blk = best.blocking;
+    std::vector<StripBlock> blocks = stripBlocks(shape.out, blk.strips);
+
+    // x is at the start of SDMEM, the weights of each block are stored in the
+    // order they are loaded: for each input, the strips of the block's outputs
+    kernel.sdmem = x;
+    std::vector<int> w_base;
+    for (const StripBlock& block : blocks) {
+        w_base.push_back((int)kernel.vdmem.size());
+        for (int i = 0; i < shape.in; i++) {
+            for (int o = block.first; o < block.first + block.strips * block.width; o++)
+                kernel.vdmem.push_back(w[o * shape.in + i]);
+        }
+    }
+    int bias_addr = (int)kernel.vdmem.size();
+    kernel.vdmem.insert(kernel.vdmem.end(), bias.begin(), bias.end());
+    kernel.out_addr = (int)kernel.vdmem.size();
+
+    Emitter e(kernel.sdmem);
+    int peel = shape.in % blk.unroll;
+    e.li("SR4", blk.unroll, "SR4 = inputs per loop iteration");
+
+    for (size_t bi = 0; bi < blocks.size(); bi++) {
+        const StripBlock& block = blocks[bi];
+        std::string outs = "outputs " + std::to_string(block.first) + "-" +
+                           std::to_string(block.first + block.strips * block.width - 1);
+
+        e.li("SR6", block.width, "SR6 = outputs per strip");
+        if (block.width != MAX_VECTOR_LEN)
+            e.op("MTCL", "SR6", "", "", "last strip is " + std::to_string(block.width) + " outputs");
+        for (int s = 0; s < block.strips; s++)
+            e.op("ADDVV", vr(1 + s), "VR0", "VR0", "clear accumulator");
+        e.li("SR1", 0, "SR1 = x, in SDMEM");
+        e.li("SR2", w_base[bi], "SR2 = weights of " + outs);
+
+        // inputs that don't fill a loop iteration go first
+        fcInputs(e, blk, block.strips, peel);
+        if (peel) {
+            e.li("SR7", peel);
+            e.op("ADD", "SR1", "SR1", "SR7");
+        }
+        if (shape.in >= blk.unroll) {
+            e.li("SR3", w_base[bi] + shape.in * block.strips * block.width, "SR3 = end of the block's weights");
+            int top = e.here();
+            fcInputs(e, blk, block.strips, blk.unroll);
+            e.op("ADD", "SR1", "SR1", "SR4");
+            e.loop("BNE", "SR2", "SR3", top, "loop over " + count(blk.unroll, "input") + " at a time");
+        }
+
+        for (int s = 0; s < block.strips; s++) {
+            int o = block.first + s * block.width;
+            std::string t = vr(block.strips + 1);
+            e.li("SR5", bias_addr + o);
+            e.op("LV", t, "SR5", "", "bias");
+            e.op("ADDVV", vr(1 + s), vr(1 + s), t);
+            e.li("SR5", kernel.out_addr + o);
+            e.op("SV", vr(1 + s), "SR5", "", "y[" + std::to_string(o) + "]");
+        }
+        if (block.width != MAX_VECTOR_LEN) {
+            e.li("SR6", MAX_VECTOR_LEN);
+            e.op("MTCL", "SR6", "", "", "vector len = 64");
+        }
+    }
+    e.op("HALT");
+
+    kernel.code = scheduleProgram(e.code, config, 1, {});
+    kernel.header = {
+        "Fully connected layer, y = W x + b with " + std::to_string(shape.in) + " inputs and " + std::to_string(shape.out) + " outputs",
+        "x is at SDMEM 0, b at VDMEM " + std::to_string(bias_addr) + ", y is saved at VDMEM " + std::to_string(kernel.out_addr),
+        "W starts at VDMEM 0 in blocks of " + count(blk.strips, "output strip") + ", each block holds",
+        "W[block outputs][0], then W[block outputs][1], ...",
+        "blocking: " + count(blk.strips, "accumulator") + ", " + count(blk.temps, "weight register") + ", " +
+            count(blk.unroll, "input") + " per loop iteration",
+    };
+    checkSizes(kernel);
+    return kernel;
+}
+
+// ---- Convolution layer ----
+
+struct ConvBlocking {
+    int strips; // output strips per block, each has an accumulator
+    int sets;   // accumulator sets, consecutive rows use them in turn
+    int temps;  // registers the input is loaded into, in turn
+    int unroll; // output rows per loop iteration
+};
+
+struct ConvGeometry {
+    int width;  // padded input width
+    int kernel;
+    int stride;
+    int out_cols;
+};
+
+// count output rows, each adds up kernel[ky][kx] times the input under it
+// (LVWS with the stride) for every tap, SR1 points at the input under the
+// first output of the row and SR3 at the output
+static void convRows(Emitter& e, const ConvBlocking& b, const ConvGeometry& g, int strips, int count) {
+    for (int c = 0; c < count; c++) {
+        int acc = 1 + (c % b.sets) * b.strips;
+        for (int tap = 0; tap < g.kernel * g.kernel; tap++) {
+            int ky = tap / g.kernel, kx = tap % g.kernel;
+            std::string k = tap % 2 ? "SR6" : "SR5";
+            e.op("LS", k, "SR0", std::to_string(tap), k + " = kernel[" + std::to_string(ky) + "][" + std::to_string(kx) + "]");
+
+            for (int s = 0; s < strips; s++) {
+                int offset = ky * g.width + kx + s * MAX_VECTOR_LEN * g.stride;
+                std::string addr = "SR1";
+                if (offset) {
+                    e.li("SR4", offset);
+                    e.op("ADD", "SR7", "SR1", "SR4");
+                    addr = "SR7";
+                }
+                std::string t = vr(1 + b.sets * b.strips + (tap * strips + s) % b.temps);
+                e.op("LVWS", t, addr, "SR2");
+                if (tap == 0) {
+                    e.op("MULVS", vr(acc + s), t, k);
+                }
+                else {
+                    e.op("MULVS", t, t, k);
+                    e.op("ADDVV", vr(acc + s), vr(acc + s), t);
+                }
+            }
+        }
+
+        for (int s = 0; s < strips; s++) {
+            std::string addr = "SR3";
+            if (s) {
+                e.li("SR4", s * MAX_VECTOR_LEN);
+                e.op("ADD", "SR7", "SR3", "SR4");
+                addr = "SR7";
+            }
+            e.op("SV", vr(acc + s), addr);
+        }
+        e.li("SR4", g.stride * g.width);
+        e.op("ADD", "SR1", "SR1", "SR4", "next output row");
+        e.li("SR4", g.out_cols);
+        e.op("ADD", "SR3", "SR3", "SR4");
+    }
+}
+
+Kernel generateConv(const ConvShape& shape, const MachineConfig& config, unsigned seed) {
+    int height = shape.rows + 2 * shape.pad, width = shape.cols + 2 * shape.pad;
+    if (shape.kernel < 1 || shape.stride < 1 || shape.pad < 0)
+        throw std::runtime_error("kernel and stride must be at least 1, pad at least 0");
+    if (shape.rows < 1 || shape.cols < 1 || height < shape.kernel || width < shape.kernel)
+        throw std::runtime_error("the padded input must be at least as big as the kernel");
+
+    int out_rows = (height - shape.kernel) / shape.stride + 1;
+    int out_cols = (width - shape.kernel) / shape.stride + 1;
+
+    Kernel kernel;
+    std::mt19937 rng(seed);
+    std::vector<int32_t> input = randomInts(rng, shape.rows * shape.cols);
+    std::vector<int32_t> weights = randomInts(rng, shape.kernel * shape.kernel);
+
+    // the input is stored with its zero padding, so no strip needs edge cases
+    kernel.vdmem.assign(height * width, 0);
+    for (int r = 0; r < shape.rows; r++) {
+        for (int c = 0; c < shape.cols; c++)
+            kernel.vdmem[(r + shape.pad) * width + c + shape.pad] = input[r * shape.cols + c];
+    }
+    kernel.out_addr = height * width;
+
+    for (int oy = 0; oy < out_rows; oy++) {
+        for (int ox = 0; ox < out_cols; ox++) {
+            int64_t sum = 0;
+            for (int ky = 0; ky < shape.kernel; ky++) {
+                for (int kx = 0; kx < shape.kernel; kx++)
+                    sum += int64_t(weights[ky * shape.kernel + kx]) *
+                           kernel.vdmem[(oy * shape.stride + ky) * width + ox * shape.stride + kx];
+            }
+            kernel.expected.push_back(int32_t(sum));
+        }
+    }
+
+    ConvGeometry geom = {width, shape.kernel, shape.stride, out_cols};
+    int full = out_cols / MAX_VECTOR_LEN;
+    Best<ConvBlocking> best;
+    for (int s = 1; s <= std::max(full, 1) && s < NUM_VREGS; s++) {
+        for (int u = 1; u <= 2; u++) {
+            for (int sets = 1; sets <= u && s * sets < NUM_VREGS; sets++) {
+                for (int t = 1; s * sets + t <= NUM_VREGS; t++) {
+                    ConvBlocking cand = {s, sets, t, u};
+                    best.consider(cand, bodyCycles([&](Emitter& e) { convRows(e, cand, geom, s, u); }, config, s * u));
+                }
+            }
+        }
+    }
+    const ConvBlocking& blk = best.blocking;
+
+    // the kernel is at the start of SDMEM
+    kernel.sdmem = weights;
+    Emitter e(kernel.sdmem);
+    int peel = out_rows % blk.unroll;
+    e.li("SR2", shape.stride, "SR2 = stride");
+
+    for (const StripBlock& block : stripBlocks(out_cols, blk.strips)) {
+        if (block.width != MAX_VECTOR_LEN) {
+            e.li("SR4", block.width);
+            e.op("MTCL", "SR4", "", "", "last strip is " + std::to_string(block.width) + " output cols");
+        }
+        e.li("SR1", block.first * shape.stride, "SR1 = input under output col " + std::to_string(block.first));
+        e.li("SR3", kernel.out_addr + block.first, "SR3 = output col " + std::to_string(block.first));
+
+        // rows that don't fill a loop iteration go first
+        convRows(e, blk, geom, block.strips, peel);
+        if (out_rows >= blk.unroll) {
+            int top = e.here();
+            convRows(e, blk, geom, block.strips, blk.unroll);
+            e.li("SR4", kernel.out_addr + block.first + out_rows * out_cols, "SR4 = end of the output");
+            e.loop("BNE", "SR3", "SR4", top, "loop over " + count(blk.unroll, "output row") + " at a time");
+        }
+        if (block.width != MAX_VECTOR_LEN) {
+            e.li("SR4", MAX_VECTOR_LEN);
+            e.op("MTCL", "SR4", "", "", "vector len = 64");
+        }
+    }
+    e.op("HALT");
+
+    kernel.code = scheduleProgram(e.code, config, 1, {});
+    kernel.header = {
+        "Convolution layer of a " + std::to_string(shape.rows) + "x" + std::to_string(shape.cols) + " matrix and " +
+            std::to_string(shape.kernel) + "x" + std::to_string(shape.kernel) + " kernel with stride " +
+            std::to_string(shape.stride) + " and padding " + std::to_string(shape.pad),
+        "the output matrix is " + std::to_string(out_rows) + "x" + std::to_string(out_cols) + ", saved at VDMEM " +
+            std::to_string(kernel.out_addr),
+        "the kernel is flattened at SDMEM 0, the padded " + std::to_string(height) + "x" + std::to_string(width) +
+            " matrix is flattened at VDMEM 0",
+        "blocking: " + count(blk.strips, "output strip") + " per block, " + count(blk.sets, "accumulator set") + ", " +
+            count(blk.temps, "input register") + ", " + count(blk.unroll, "row") + " per loop iteration",
+    };
+    checkSizes(kernel);
+    return kernel;
+}
+
+// ---- Output ----
+
+static void saveWords(const std::vector<int32_t>& words, const std::filesystem::path fp) {
+    std::ofstream file(fp);
+    if (!file.is_open()) {
+        throw std::runtime_error("Error opening output file: " + fp.string());
+    }
+    for (int32_t word : words)
+        file << word << std::endl;
+}
+
+void saveKernel(const Kernel& kernel, const std::filesystem::path iodir) {
+    std::filesystem::path code_fp = iodir / "Code.asm";
+    std::ofstream code_file(code_fp);
+    if (!code_file.is_open()) {
+        throw std::runtime_error("Error opening output file: " + code_fp.string());
+    }
+
+    for (const std::string& line : kernel.header)
+        code_file << "# " << line << std::endl;
+    for (const AsmInstr& instr : kernel.code) {
+        for (size_t i = 0; i < instr.parts.size() && !instr.parts[i].empty(); i++)
+            code_file << (i ? " " : "") << instr.parts[i];
+        if (!instr.comment.empty())
+            code_file << " # " << instr.comment;
+        code_file << std::endl;
+    }
+
+    saveWords(kernel.sdmem, iodir / "SDMEM.txt");
+    saveWords(kernel.vdmem, iodir / "VDMEM.txt");
+
+    std::filesystem::path expected_fp = iodir / "Expected.txt";
+    std::ofstream expected_file(expected_fp);
+    if (!expected_file.is_open()) {
+        throw std::runtime_error("Error opening output file: " + expected_fp.string());
+    }
+    for (size_t i = 0; i < kernel.expected.size(); i++)
+        expected_file << kernel.out_addr + i << " " << kernel.expected[i] << std::endl;
+}
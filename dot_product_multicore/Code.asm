@@ -0,0 +1,43 @@
+# dot product of the 450 element vectors at VDMEM 0 and 450, split across 2 cores
+# each core's SDMEM<i>.txt gives its half, the result is saved in addr 2048 in vdm
+LS SR1 SR0 0 # SR1 = 33, first strip, 225 % 64
+LS SR2 SR0 1 # SR2 = start of this core's half of a
+LS SR3 SR0 2 # SR3 = start of this core's half of b
+LS SR4 SR0 3 # SR4 = end of this core's half of a
+MTCL SR1
+LV VR1 SR2
+LV VR2 SR3
+MULVV VR3 VR1 VR2 # VR3 = [VR1[0]*VR2[0], ..., 0, ...]
+ADD SR2 SR2 SR1
+ADD SR3 SR3 SR1
+POP SR5 # SR5 = 64
+MTCL SR5 # Vector Len = 64
+LV VR1 SR2
+LV VR2 SR3
+MULVV VR4 VR1 VR2
+ADDVV VR3 VR3 VR4 # keep adding to VR3, the partial sum
+ADD SR2 SR2 SR5 # SR2 += 64
+ADD SR3 SR3 SR5 # SR3 += 64
+BNE SR2 SR4 -6 # for looping
+LS SR6 SR0 4 # SR6 = 6
+LS SR7 SR0 5 # SR7 = 1
+SUB SR1 SR1 SR1 # SR1 = 0
+PACKLO VR5 VR3 VR0 # halve the vector 6 times, like dot_product
+PACKHI VR6 VR3 VR0
+ADDVV VR3 VR5 VR6
+ADD SR1 SR1 SR7
+BNE SR1 SR6 -4 # for looping
+MTCL SR7 # Vector Len = 1
+LS SR2 SR0 6 # SR2 = 2049 + core
+SV VR3 SR2 # this core's partial sum
+BARRIER # every core's partial sum is in VDMEM after this
+LS SR3 SR0 7 # SR3 = 1 on the core that adds the partial sums
+BEQ SR3 SR0 8 # the other cores are done
+LS SR2 SR0 8 # SR2 = 2049
+LV VR1 SR2 # core 0's partial sum
+ADD SR2 SR2 SR7
+LV VR2 SR2 # core 1's partial sum
+ADDVV VR3 VR1 VR2
+LS SR2 SR0 9 # SR2 = 2048
+SV VR3 SR2
+HALT
@@ -0,0 +1,145 @@
+"""
+VMIPS Vector Processor Co-Simulator
+Runs the functional simulator and the timing simulator together, the trace
+is streamed between them through a bounded ring instead of trace.asm
+Authors: Gaurav Kuwar, Ritvik Nair
+"""
+
+import os
+import argparse
+import threading
+from contextlib import redirect_stdout
+
+from verify_program import verifyCode
+from funcsimulator import IMEM, DMEM, Core
+from timingsimulator import Config, TimingSim, OoOTimingSim, Profiler, report
+
+class TraceRing:
+    """
+    Bounded single producer/single consumer ring of trace lines.
+    head is only written by the consumer and tail only by the producer, and a
+    slot is written before tail moves past it, so pushes and pops take no lock.
+    The condition is only used to sleep: the producer waits on it while the
+    ring is full and the consumer while it is empty, so the waiting thread
+    gives up the GIL instead of polling. The waiter checks again under the lock
+    before it sleeps, and the other side only takes the lock to notify when its
+    push or pop could have moved the ring off empty or full, so no wakeup is lost.
+    """
+    def __init__(self, depth):
+        self.depth = depth
+        self.slots = [None] * depth
+        self.head = 0 # next slot to pop
+        self.tail = 0 # next slot to push
+        self.closed = False
+        self.error = None # exception raised by the producer
+        self.cond = threading.Condition()
+
+        # stats
+        self.fullWaits = 0  # times the producer found the ring full
+        self.emptyWaits = 0 # times the consumer found the ring empty
+        self.peak = 0
+
+    def push(self, line):
+        if self.tail - self.head == self.depth:
+            self.fullWaits += 1
+            with self.cond:
+                while self.tail - self.head == self.depth:
+                    self.cond.wait() # until the consumer pops
+
+        self.slots[self.tail % self.depth] = line
+        self.tail += 1
+        count = self.tail - self.head
+        self.peak = max(self.peak, count)
+        # a sleeping consumer saw the ring empty and can't have popped since,
+        # so this push took it from empty to 1
+        if count <= 1:
+            with self.cond:
+                self.cond.notify()
+
+    def close(self, error=None):
+        "no more pushes, called by the producer after the last push"
+        with self.cond:
+            self.error = error
+            self.closed = True
+            self.cond.notify()
+
+    def __iter__(self):
+        while True:
+            if self.head == self.tail:
+                self.emptyWaits += 1
+                with self.cond:
+                    while self.head == self.tail and not self.closed:
+                        self.cond.wait() # until the producer pushes or closes
+
+                # closed is set after the last push, so the ring is drained
+                if self.head == self.tail:
+                    if self.error:
+                        raise RuntimeError("functional simulator failed") from self.error
+                    return
+
+            idx = self.head % self.depth
+            line = self.slots[idx]
+            self.slots[idx] = None
+            self.head += 1
+            # a sleeping producer saw the ring full and can't have pushed since,
+            # so this pop took it from full to depth - 1
+            if self.tail - self.head >= self.depth - 1:
+                with self.cond:
+                    self.cond.notify()
+            yield line
+
+def runFuncSim(vcore, ring, logfile):
+    "producer thread, the per instr output of the func sim goes to logfile"
+    error = None
+    try:
+        with open(logfile, 'w') as log, redirect_stdout(log):
+            vcore.run()
+    except Exception as e:
+        error = e
+    ring.close(error)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Vector Processor Co-Simulator')
+    parser.add_argument('--iodir', default="", type=str, help='Path to the folder containing the input files - instructions and data.')
+    parser.add_argument('-p', '--profile', default=False, action='store_true', help="save per PC cycles as Code.annotated.asm and profile.folded")
+    parser.add_argument('--dump', default="full", choices=["full", "delta"], help="save all of SDMEM/VDMEM, or only the words that changed")
+    parser.add_argument('--ring-depth', default=1024, type=int, help="number of trace lines the ring between the simulators can hold")
+    args = parser.parse_args()
+
+    iodir = os.path.abspath(args.iodir)
+    print("IO Directory:", iodir)
+
+    config = Config(iodir)
+
+    verifyCode(os.path.abspath(os.path.join(iodir, "Code.asm")))
+    imem = IMEM(iodir)
+    sdmem = DMEM("SDMEM", iodir, 13)
+    vdmem = DMEM("VDMEM", iodir, 17)
+
+    ring = TraceRing(args.ring_depth)
+    vcore = Core(imem, sdmem, vdmem, traceSink=ring)
+
+    issueMode = config.parameters.get("issueMode", "inorder")
+    ts = OoOTimingSim(ring, config) if issueMode == "ooo" else TimingSim(ring, config)
+
+    if args.profile:
+        ts.profiler = Profiler()
+
+    # redirect_stdout swaps sys.stdout for every thread, the timing sim
+    # doesn't print while running so only the func sim output ends up in out.txt
+    print(f"Running func simulator and timing simulator ({issueMode} issue)...")
+    funcThread = threading.Thread(target=runFuncSim, args=(vcore, ring, "out.txt"), daemon=True)
+    funcThread.start()
+    ts.run()
+    funcThread.join()
+    print("Saved output of func simulator in out.txt")
+
+    vcore.dumpregs(iodir)
+    for dmem in (sdmem, vdmem):
+        if args.dump == "delta":
+            dmem.dumpDelta()
+        else:
+            dmem.dump()
+
+    print(f"Trace ring: depth {ring.depth}, peak {ring.peak}, producer waits {ring.fullWaits}, consumer waits {ring.emptyWaits}")
+    report(ts, iodir)
@@ -10,6 +10,8 @@ from verify_program import verifyCode, rmComments, allVecInstrs
 REG_COUNT = 8
 REG_BITS = 32
 MAX_VECTOR_LEN = 64
+ELEMENT_WIDTHS = (8, 16, 32) # set with MTEW, a vector register holds 64, 128 or 256 elements
+MAX_LANES = MAX_VECTOR_LEN * REG_BITS // min(ELEMENT_WIDTHS)
 
 # hashmap for operation functions
 opFunc = {
@@ -20,9 +22,9 @@ opFunc = {
     "AND": lambda x, y: x & y,
     "OR":  lambda x, y: x | y,
     "XOR": lambda x, y: x ^ y,
-    "SLL": lambda x, y: x << y, # Logical Left Shift
-    "SRL": lambda x, y: x >> y, # Logical Right Shift
-    "SRA": lambda x, y: x >> y, # FIXED: Arithmetic Right Shift
+    "SLL": lambda x, y: x << (y & 31), # Logical Left Shift, shift amounts use the low 5 bits
+    "SRL": lambda x, y: (x & 0xFFFFFFFF) >> (y & 31), # FIXED: Logical Right Shift
+    "SRA": lambda x, y: x >> (y & 31), # FIXED: Arithmetic Right Shift
     "EQ": lambda x, y: int(x == y),
     "NE": lambda x, y: int(x != y),
     "GT": lambda x, y: int(x > y),
@@ -35,10 +37,43 @@ boolIntrs = {'EQ', 'NE', 'GT', 'LT', 'GE', 'LE'}
 def padding(a, N=4): # just a helper function to split instructions
     return (a + N * [None])[:N]
 
+# Packed elements
+# with element width ew < 32, each 32 bit word holds 32 // ew elements,
+# element 0 in the low bits. Elements are signed and wrap around on overflow.
+
+def wrap(val, ew): # two's complement wrap around to ew bits
+    val &= (1 << ew) - 1
+    return val - (1 << ew) if val >> (ew - 1) else val
+
+def saturate(val, ew): # clamp to the range of a signed ew bit int
+    return max(-(1 << (ew - 1)), min((1 << (ew - 1)) - 1, val))
+
+def unpackWords(words, ew):
+    "words -> elements"
+    k = REG_BITS // ew
+    return [wrap(word >> (ew * lane), ew) for word in words for lane in range(k)]
+
+def packWords(elems, ew):
+    "elements -> words, len(elems) is a multiple of 32 // ew"
+    k = REG_BITS // ew
+    mask = (1 << ew) - 1
+    words = []
+    for w in range(len(elems) // k):
+        word = 0
+        for lane in range(k):
+            word |= (elems[w * k + lane] & mask) << (ew * lane)
+        words.append(wrap(word, REG_BITS))
+    return words
+
+def setElem(word, lane, val, ew):
+    "returns word with one element replaced"
+    mask = ((1 << ew) - 1) << (ew * lane)
+    return wrap((word & ~mask) | ((val << (ew * lane)) & mask), REG_BITS)
+
 class IMEM(object):
-    def __init__(self, iodir):
+    def __init__(self, iodir, filename="Code.asm"):
         self.size = pow(2, 16) # Can hold a maximum of 2^16 instructions.
-        self.filepath = os.path.abspath(os.path.join(iodir, "Code.asm"))
+        self.filepath = os.path.abspath(os.path.join(iodir, filename))
         self.instructions = []
 
         try:
@@ -58,41 +93,92 @@ class IMEM(object):
         else:
             print("IMEM - ERROR: Invalid memory access at index: ", idx, " with memory size: ", self.size)
 
+PAGE_BITS = 10 # DMEM page is 1024 words
+PAGE_SIZE = 1 << PAGE_BITS
+ZERO_PAGE = (0,) * PAGE_SIZE # shared by all pages that are not in the input file
+
 class DMEM(object):
     # Word addressible - each address contains 32 bits.
-    def __init__(self, name, iodir, addressLen):
+    # Paged: pages keep the input image until their first write, when they get a
+    # copy of their own, so untouched pages cost nothing and dirty pages are known
+    # the input file is name.txt, or ipname.txt if given (ex. cores that share an SDMEM input)
+    def __init__(self, name, iodir, addressLen, ipname=None):
         self.name = name
         self.size = pow(2, addressLen)
         self.min_value  = -pow(2, 31)
         self.max_value  = pow(2, 31) - 1
-        self.ipfilepath = os.path.abspath(os.path.join(iodir, name + ".txt"))
+        self.ipfilepath = os.path.abspath(os.path.join(iodir, (ipname or name) + ".txt"))
         self.opfilepath = os.path.abspath(os.path.join(iodir, name + "OP.txt"))
-        self.data = []
+        self.deltafilepath = os.path.abspath(os.path.join(iodir, name + "OP.delta.txt"))
+
+        numPages = (self.size + PAGE_SIZE - 1) // PAGE_SIZE
+        self.base = [ZERO_PAGE] * numPages # input image, never written
+        self.pages = list(self.base)
+        self.dirty = set() # pages with their own copy
 
         try:
             with open(self.ipfilepath, 'r') as ipf:
-                self.data = [int(line.strip()) for line in ipf.readlines()]
+                data = [int(line.strip()) for line in ipf.readlines()]
             print(self.name, "- Data loaded from file:", self.ipfilepath)
-            # print(self.name, "- Data:", self.data)
-            self.data.extend([0x0 for i in range(self.size - len(self.data))])
+            # print(self.name, "- Data:", data)
+            for p in range(0, len(data), PAGE_SIZE):
+                page = data[p:p + PAGE_SIZE]
+                self.base[p >> PAGE_BITS] = tuple(page + [0x0] * (PAGE_SIZE - len(page)))
+            self.pages = list(self.base)
         except:
             print(self.name, "- ERROR: Couldn't open input file in path:", self.ipfilepath)
 
     def Read(self, idx): # Use this to read from DMEM.
-        return self.data[idx]
+        return self.pages[idx >> PAGE_BITS][idx & (PAGE_SIZE - 1)]
 
     def Write(self, idx, val): # Use this to write into DMEM.
-        self.data[idx] = val
+        p = idx >> PAGE_BITS
+        if p not in self.dirty:
+            self.pages[p] = list(self.base[p])
+            self.dirty.add(p)
+        self.pages[p][idx & (PAGE_SIZE - 1)] = val
 
     def dump(self):
+        # all words, one per line
         try:
             with open(self.opfilepath, 'w') as opf:
-                lines = [str(data) + '\n' for data in self.data]
-                opf.writelines(lines)
+                zeroLines = '0\n' * PAGE_SIZE
+                for p, page in enumerate(self.pages):
+                    n = min(PAGE_SIZE, self.size - p * PAGE_SIZE)
+                    if page is ZERO_PAGE and n == PAGE_SIZE:
+                        opf.write(zeroLines)
+                    else:
+                        opf.writelines(str(data) + '\n' for data in page[:n])
             print(self.name, "- Dumped data into output file in path:", self.opfilepath)
         except:
             print(self.name, "- ERROR: Couldn't open output file in path:", self.opfilepath)
 
+    def changedRanges(self):
+        "(start addr, values) of each run of words that differ from the input image"
+        ranges = []
+        for p in sorted(self.dirty):
+            page, base = self.pages[p], self.base[p]
+            for i in range(PAGE_SIZE):
+                if page[i] == base[i]: continue
+                addr = (p << PAGE_BITS) + i
+                if ranges and ranges[-1][0] + len(ranges[-1][1]) == addr:
+                    ranges[-1][1].append(page[i])
+                else:
+                    ranges.append((addr, [page[i]]))
+        return ranges
+
+    def dumpDelta(self):
+        # only the words that changed, each run starts with an "@ addr" line
+        try:
+            with open(self.deltafilepath, 'w') as opf:
+                opf.write(f"# {self.name} changes from {self.name}.txt, {self.size} words\n")
+                for addr, values in self.changedRanges():
+                    opf.write(f"@ {addr}\n")
+                    opf.writelines(str(data) + '\n' for data in values)
+            print(self.name, "- Dumped changed words into output file in path:", self.deltafilepath)
+        except:
+            print(self.name, "- ERROR: Couldn't open output file in path:", self.deltafilepath)
+
 class RegisterFile(object):
     def __init__(self, name, count, length = 1, size = 32):
         self.name       = name
@@ -124,8 +210,8 @@ class RegisterFile(object):
                 if elem != None:
                     self.registers[idx][i] = elem
 
-    def dump(self, iodir):
-        opfilepath = os.path.abspath(os.path.join(iodir, self.name + ".txt"))
+    def dump(self, iodir, suffix=""):
+        opfilepath = os.path.abspath(os.path.join(iodir, self.name + suffix + ".txt"))
         try:
             with open(opfilepath, 'w') as opf:
                 row_format = "{:<13}"*self.vec_length
@@ -157,50 +243,128 @@ class VectorMaskRegister():
     def clear(self): # for CVM instr
         self.mask = [1] * len(self.mask)
 
-    def count1s(self): # for POP instr
-        return sum(self.mask)
+    def count1s(self, n): # for POP instr, n is the number of elements per register
+        return sum(self.mask[:n])
     
 class Trace:
     # get dynamic flow trace
-    def __init__(self):
+    # each line is tagged with the static PC of the instr, ex. "ADD SR1 SR1 SR2 # 12"
+    # with a sink (ex. a TraceRing) lines are pushed to it once they are final, instead of being kept
+    def __init__(self, sink=None):
         self.lines = []
+        self.pcs = []
+        self.sink = sink
 
-    def append(self, line, vlen=None):
+    def append(self, line, vlen=None, pc=None):
+        # update() only edits the last line, so it's final once the next one is appended
+        if self.sink is not None: self.flush()
         if vlen: line += f" {vlen}"
         self.lines.append(line)
+        self.pcs.append(pc)
 
     def update(self, line, vlen=None):
         if not self.lines: raise Exception("TraceError: no lines to update")
         if vlen: line += f" {vlen}"
         self.lines[-1] = line
 
+    def tagged(self, idx):
+        pc = self.pcs[idx]
+        return self.lines[idx] if pc is None else f"{self.lines[idx]} # {pc}"
+
+    def intervalVectors(self, size):
+        """
+        basic block and opcode mix vector of each interval of size dynamic instrs (the last may be shorter).
+        Counting the instrs of each static PC gives the basic block vector weighted by block size,
+        in the opcode mix a vector op counts as vlen / MAX_VECTOR_LEN
+        """
+        vectors = []
+        for start in range(0, len(self.lines), size):
+            vec = {}
+            for idx in range(start, min(start + size, len(self.lines))):
+                parts = self.lines[idx].split()
+                if self.pcs[idx] is not None:
+                    vec[("pc", self.pcs[idx])] = vec.get(("pc", self.pcs[idx]), 0) + 1
+                if parts[-1].startswith("e"): parts.pop() # element width of packed instrs
+                weight = int(parts[-1]) / MAX_VECTOR_LEN if parts[0] in allVecInstrs else 1
+                vec[("op", parts[0])] = vec.get(("op", parts[0]), 0) + weight
+            vectors.append(vec)
+        return vectors
+
+    def flush(self):
+        "push the kept lines to the sink"
+        for i in range(len(self.lines)):
+            self.sink.push(self.tagged(i))
+        self.lines = []
+        self.pcs = []
+
     def save(self, outfile):
         with open(outfile, 'w') as f:
-            f.write('\n'.join(self.lines))
+            f.write('\n'.join(self.tagged(i) for i in range(len(self.lines))))
 
         print("Saved dynamic flow trace")
 
 class Core():
-    def __init__(self, imem, sdmem, vdmem):
+    def __init__(self, imem, sdmem, vdmem, traceSink=None, barrier=None):
         self.IMEM = imem
         self.SDMEM = sdmem
         self.VDMEM = vdmem
+        self.barrier = barrier # shared by the cores in multi-core mode, BARRIER is a no-op without it
 
         self.RFs = {"SRF": RegisterFile("SRF", REG_COUNT),
                     "VRF": RegisterFile("VRF", REG_COUNT, MAX_VECTOR_LEN)}
         
         # Your code here.
         self.vLen = MAX_VECTOR_LEN
-        self.vMask = VectorMaskRegister(MAX_VECTOR_LEN) # vector mask register
-        self.trace = Trace() # trace code
+        self.ew = 32 # element width
+        self.vMask = VectorMaskRegister(MAX_LANES) # vector mask register, one bit per element
+        self.trace = Trace(traceSink) # trace code
+
+    def mvl(self): # max vector len at the current element width
+        return MAX_VECTOR_LEN * REG_BITS // self.ew
+
+    def lanesPerWord(self):
+        return REG_BITS // self.ew
+
+    def vlenTag(self): # vector len in the trace, packed instrs also have their element width
+        return self.vLen if self.ew == REG_BITS else f"{self.vLen} e{self.ew}"
+
+    def readVec(self, reg): # the elements of a vector register
+        words = self.RFs['VRF'].Read(reg)
+        return words if self.ew == REG_BITS else unpackWords(words, self.ew)
+
+    def writeVec(self, reg, vec): # like RegisterFile.Write, None leaves the element as it is
+        if self.ew == REG_BITS:
+            self.RFs['VRF'].Write(reg, [None if elem is None else wrap(elem, REG_BITS) for elem in vec])
+            return
+
+        elems = self.readVec(reg)
+        for i, elem in enumerate(vec):
+            if elem is not None:
+                elems[i] = wrap(elem, self.ew)
+        self.RFs['VRF'].Write(reg, packWords(elems, self.ew))
+
+    def readElem(self, addr): # addr is an element addr, word addr * lanesPerWord() + lane
+        k = self.lanesPerWord()
+        return wrap(self.VDMEM.Read(addr // k) >> (self.ew * (addr % k)), self.ew) if k > 1 else self.VDMEM.Read(addr)
+
+    def writeElem(self, addr, val):
+        k = self.lanesPerWord()
+        if k == 1:
+            self.VDMEM.Write(addr, val)
+        else:
+            self.VDMEM.Write(addr // k, setElem(self.VDMEM.Read(addr // k), addr % k, val, self.ew))
+
+    def wordAddrs(self, addrs): # VDMEM words touched by element addrs, in order
+        k = self.lanesPerWord()
+        return tuple(dict.fromkeys(addr // k for addr in addrs)) if k > 1 else tuple(addrs)
 
     def aluOp(self, operator, op1, op2, op3):
         if op2.startswith("SR") and op3.startswith("SR"):
             res = opFunc[operator](self.RFs['SRF'].Read(op2), self.RFs['SRF'].Read(op3))
-            self.RFs['SRF'].Write(op1, res)
+            self.RFs['SRF'].Write(op1, wrap(res, REG_BITS)) # FIXED: wraps around at 32 bits
         else:
-            op2Val = self.RFs['VRF'].Read(op2)
-            op3Val = self.RFs['VRF'].Read(op3) if op3.startswith("VR") else [self.RFs['SRF'].Read(op3)] * MAX_VECTOR_LEN
+            op2Val = self.readVec(op2)
+            op3Val = self.readVec(op3) if op3.startswith("VR") else [self.RFs['SRF'].Read(op3)] * self.mvl()
             res = [0] * self.vLen
             
             for i in range(self.vLen):
@@ -209,7 +373,7 @@ class Core():
             if operator in boolIntrs: # for S__VV and S__VS instructions
                 self.vMask.write(res)
             else:
-                self.RFs['VRF'].Write(op1, self.vMask.apply(res))
+                self.writeVec(op1, self.vMask.apply(res))
 
     def unpack(self, VR1, VR2, VR3, N, isLo=False):
         offset = (N // 2) if isLo else 0 
@@ -230,29 +394,57 @@ class Core():
             VR1[i] = vr1Tmp[i] # make sure we change the actual register values
 
     def lv(self, op1, op2, op3): # for LV and LVWS
-        address = self.RFs['SRF'].Read(op2)
+        # packed elements are addressed from the start of the word at address, stride is in elements
+        address = self.RFs['SRF'].Read(op2) * self.lanesPerWord()
         stride = self.RFs['SRF'].Read(op3) if op3 is not None else 1
         res = []
 
         for i in range(self.vLen):
-            res.append(self.VDMEM.Read(address + (stride * i)))
+            res.append(self.readElem(address + (stride * i)))
 
         # FIXED: applied mask
-        self.RFs['VRF'].Write(op1, self.vMask.apply(res))
+        self.writeVec(op1, self.vMask.apply(res))
 
         instrType = "LVWS" if op3 else "LV"
-        self.trace.update(f"{instrType} {op1} {tuple(address + (stride * i) for i in range(self.vLen))}", self.vLen) # trace
+        self.trace.update(f"{instrType} {op1} {self.wordAddrs(address + (stride * i) for i in range(self.vLen))}", self.vlenTag()) # trace
 
     def sv(self, op1, op2, op3): # for SV and SVWS
-        address = self.RFs['SRF'].Read(op2)
+        address = self.RFs['SRF'].Read(op2) * self.lanesPerWord()
         stride = self.RFs['SRF'].Read(op3) if op3 is not None else 1
-        vec = self.vMask.apply(self.RFs['VRF'].Read(op1)) # FIXED: applied mask
+        vec = self.vMask.apply(self.readVec(op1)) # FIXED: applied mask
         
         for i in range(self.vLen):
-            self.VDMEM.Write(address + (stride * i), vec[i])
+            if vec[i] is not None: # FIXED: masked elements aren't stored
+                self.writeElem(address + (stride * i), vec[i])
         
         instrType = "SVWS" if op3 else "SV"
-        self.trace.update(f"{instrType} {op1} {tuple(address + (stride * i) for i in range(self.vLen))}", self.vLen) # trace
+        self.trace.update(f"{instrType} {op1} {self.wordAddrs(address + (stride * i) for i in range(self.vLen))}", self.vlenTag()) # trace
+
+    def macw(self, op1, op2, op3): # widening multiply accumulate
+        # op1 has 32 bit accumulators, accumulator j adds the products of
+        # elements [j * k, (j + 1) * k) of op2 and op3, with k elements per word
+        k = self.lanesPerWord()
+        acc = list(self.RFs['VRF'].Read(op1))
+        vec2, vec3 = self.readVec(op2), self.readVec(op3)
+
+        for i in range(self.vLen):
+            if self.vMask.mask[i]:
+                acc[i // k] = wrap(acc[i // k] + vec2[i] * vec3[i], REG_BITS)
+        self.RFs['VRF'].Write(op1, acc)
+
+    def svn(self, op1, op2): # saturating narrow store
+        # stores the 32 bit elements of op1 as packed elements, clamped to the element width
+        # like MACW, the 32 bit side has one element per k elements of the vector len
+        k = self.lanesPerWord()
+        address = self.RFs['SRF'].Read(op2) * k
+        words = self.RFs['VRF'].Read(op1)
+        n = -(-self.vLen // k)
+
+        for i in range(n):
+            if self.vMask.mask[i]:
+                self.writeElem(address + i, saturate(words[i], self.ew))
+
+        self.trace.update(f"SVN {op1} {self.wordAddrs(address + i for i in range(n))}", self.vlenTag()) # trace
 
     def run(self):
         PC = 0 # program counter
@@ -263,26 +455,44 @@ class Core():
             instrType, op1, op2, op3 = padding(instr.split())
 
             if instrType in allVecInstrs:
-                self.trace.append(instr, self.vLen) # add vector len to trace
+                self.trace.append(instr, self.vlenTag(), PC) # add vector len to trace
             else:
-                self.trace.append(instr)
+                self.trace.append(instr, pc=PC)
             
+            if instrType == "BARRIER" and self.barrier: # wait for the other cores
+                self.barrier.wait()
+
             if instrType == "CVM": # clear vector mask register - set to all 1's
                 self.vMask.clear()
 
             if instrType == "POP": # store # of 1s in vector mask register
-                self.RFs['SRF'].Write(op1, self.vMask.count1s())
+                self.RFs['SRF'].Write(op1, self.vMask.count1s(self.mvl()))
 
             if instrType == "MTCL": # Move the contents of the Scalar Register SR1 into the Vector Length Register
                 self.vLen = self.RFs['SRF'].Read(op1)
 
             if instrType == "MFCL": # Move the contents of the Vector Length Register into the Scalar Register SR1
                 self.RFs['SRF'].Write(op1, self.vLen)
+
+            if instrType == "MTEW": # Set the element width to SR1 bits, and the vector len to the max for it
+                if self.RFs['SRF'].Read(op1) not in ELEMENT_WIDTHS:
+                    raise Exception(f"Invalid element width {self.RFs['SRF'].Read(op1)}, must be one of {ELEMENT_WIDTHS}")
+                self.ew = self.RFs['SRF'].Read(op1)
+                self.vLen = self.mvl()
+
+            if instrType == "MFEW": # Move the element width into SR1
+                self.RFs['SRF'].Write(op1, self.ew)
+
+            if instrType == "MACW":
+                self.macw(op1, op2, op3)
+
+            if instrType == "SVN":
+                self.svn(op1, op2)
             
             # ALU operations
             for operator in ("ADD", "SUB", "DIV", "MUL", 
                              "AND", "OR", "XOR", 
-                             "SLL", "SLA", "SRA"):
+                             "SLL", "SRL", "SRA"): # FIXED: SRL was spelt SLA
                 if operator in instrType:
                     self.aluOp(operator, op1, op2, op3)
 
@@ -300,25 +510,25 @@ class Core():
 
             # Load/Store Scatter-Gather 
             if instrType == "LVI":
-                address = self.RFs['SRF'].Read(op2)
-                vec2 = self.RFs['VRF'].Read(op3)
+                address = self.RFs['SRF'].Read(op2) * self.lanesPerWord()
+                vec2 = self.readVec(op3)
                 res = []
 
                 for i in range(self.vLen):
-                    res.append(self.VDMEM.Read(address + vec2[i]))
+                    res.append(self.readElem(address + vec2[i]))
 
-                self.RFs['VRF'].Write(op1, res)
-                self.trace.update(f"LVI {op1} {tuple(address + vec2[i] for i in range(self.vLen))}", self.vLen) # trace
+                self.writeVec(op1, res)
+                self.trace.update(f"LVI {op1} {self.wordAddrs(address + vec2[i] for i in range(self.vLen))}", self.vlenTag()) # trace
 
             if instrType == "SVI":
-                address = self.RFs['SRF'].Read(op2)
-                vec = self.RFs['VRF'].Read(op1)
-                vec2 = self.RFs['VRF'].Read(op3)
+                address = self.RFs['SRF'].Read(op2) * self.lanesPerWord()
+                vec = self.readVec(op1)
+                vec2 = self.readVec(op3)
 
                 for i in range(self.vLen):
-                    self.VDMEM.Write(address + vec2[i], vec[i])
+                    self.writeElem(address + vec2[i], vec[i])
 
-                self.trace.update(f"SVI {op1} {tuple(address + vec2[i] for i in range(self.vLen))}", self.vLen) # trace
+                self.trace.update(f"SVI {op1} {self.wordAddrs(address + vec2[i] for i in range(self.vLen))}", self.vlenTag()) # trace
 
             # Load/Store Scalar
             if instrType == "LS":
@@ -335,7 +545,8 @@ class Core():
             # Register-Register Shuffle
             # 2 functions for pack and unpack
             if "PACK" in instrType:
-                VR1, VR2, VR3 = self.RFs['VRF'].Read(op1), self.RFs['VRF'].Read(op2), self.RFs['VRF'].Read(op3)
+                # packed elements are shuffled as copies and written back at the end
+                VR1, VR2, VR3 = self.readVec(op1), self.readVec(op2), self.readVec(op3)
                 if instrType == "UNPACKLO":
                     self.unpack(VR1, VR2, VR3, self.vLen)
                 
@@ -347,13 +558,17 @@ class Core():
 
                 if instrType == "PACKHI":
                     self.pack(VR1, VR2, VR3, self.vLen, isOdd=True)  
+
+                if self.ew != REG_BITS:
+                    self.writeVec(op1, VR1)
             
 
             # Branch operations (Scalar)
             # Note: when incrementing PC, blank lines or lines with only comments are ignored 
 
-            branch_taken = instrType.startswith("B") and opFunc[instrType[1:]](self.RFs['SRF'].Read(op1), self.RFs['SRF'].Read(op2))
-            branch_not_taken = instrType.startswith("B") and not opFunc[instrType[1:]](self.RFs['SRF'].Read(op1), self.RFs['SRF'].Read(op2))
+            isBranch = instrType.startswith("B") and instrType[1:] in boolIntrs
+            branch_taken = isBranch and opFunc[instrType[1:]](self.RFs['SRF'].Read(op1), self.RFs['SRF'].Read(op2))
+            branch_not_taken = isBranch and not opFunc[instrType[1:]](self.RFs['SRF'].Read(op1), self.RFs['SRF'].Read(op2))
 
             if branch_taken:
                 self.trace.update(f"B ({PC + int(op3)})") # trace
@@ -367,16 +582,17 @@ class Core():
             print("VRF:")
             for i, v in enumerate(self.RFs['VRF'].registers):
                 print(f'VR{i}:', v)
-            print("V Mask:\n", self.vMask.mask)
+            print("V Mask:\n", self.vMask.mask[:self.mvl()])
             print('-' * 10, '\n')
 
-        self.trace.append("HALT")
+        self.trace.append("HALT", pc=PC)
+        if self.trace.sink is not None: self.trace.flush()
         print()
 
 
-    def dumpregs(self, iodir):
+    def dumpregs(self, iodir, suffix=""):
         for rf in self.RFs.values():
-            rf.dump(iodir)
+            rf.dump(iodir, suffix)
 
 
 if __name__ == "__main__":
@@ -384,6 +600,7 @@ if __name__ == "__main__":
     parser = argparse.ArgumentParser(description='Vector Core Performance Model')
     parser.add_argument('--iodir', default="", type=str, help='Path to the folder containing the input files - instructions and data.')
     parser.add_argument('-t', '--trace', default=False, action='store_true', help="save trace of dynamic flow for timing simulator")
+    parser.add_argument('--dump', default="full", choices=["full", "delta"], help="save all of SDMEM/VDMEM, or only the words that changed")
     args = parser.parse_args()
 
     iodir = os.path.abspath(args.iodir)
@@ -407,8 +624,11 @@ if __name__ == "__main__":
     vcore.run()   
     vcore.dumpregs(iodir)
 
-    sdmem.dump()
-    vdmem.dump()
+    for dmem in (sdmem, vdmem):
+        if args.dump == "delta":
+            dmem.dumpDelta()
+        else:
+            dmem.dump()
 
     if args.trace:
         vcore.trace.save(os.path.abspath(os.path.join(iodir, "trace.asm"))) # save trace
@@ -0,0 +1,190 @@
+"""
+VMIPS Vector Processor Multi-Core Simulator
+N cores, each with its own registers, PC and SDMEM, share one VDMEM and sync
+with BARRIER. Every core's functional sim runs on its own host thread, then
+the timing sim runs the cores in lockstep with shared VDMEM banks.
+Authors: Gaurav Kuwar, Ritvik Nair
+"""
+
+import os
+import sys
+import argparse
+import threading
+
+from verify_program import verifyCode
+from funcsimulator import IMEM, DMEM, Core
+from timingsimulator import Config, MultiCoreTimingSim
+
+class ThreadStdout:
+    "sends prints to a file per thread, so the cores' logs don't get mixed"
+    def __init__(self, default):
+        self.default = default
+        self.local = threading.local()
+
+    def setFile(self, f):
+        self.local.file = f
+
+    def write(self, text):
+        return getattr(self.local, "file", self.default).write(text)
+
+    def flush(self):
+        getattr(self.local, "file", self.default).flush()
+
+class CoreVDMEM:
+    """
+    A core's view of the shared VDMEM between two barriers (an epoch).
+    Reads see VDMEM as it was at the start of the epoch plus the core's own
+    writes, and writes are only merged into VDMEM at the barrier, so the
+    result doesn't depend on how the host threads interleave.
+    """
+    def __init__(self, vdmem, coreId):
+        self.vdmem = vdmem
+        self.coreId = coreId
+        self.writes = {} # addr: val
+        self.reads = set()
+
+    def Read(self, idx):
+        if idx in self.writes:
+            return self.writes[idx]
+        self.reads.add(idx)
+        return self.vdmem.Read(idx)
+
+    def Write(self, idx, val):
+        self.writes[idx] = val
+
+class SharedMemoryBarrier:
+    """
+    BARRIER for the cores' host threads. When the last live core arrives the
+    epoch ends: writes of all the cores are checked for conflicts and merged
+    into VDMEM in core order. Cores that halted leave, their writes are merged
+    at the next barrier (or at the end).
+    """
+    def __init__(self, views):
+        self.views = views
+        self.live = len(views)
+        self.arrived = 0
+        self.generation = 0
+        self.epoch = 0
+        self.conflicts = [] # (epoch, addr, kind, cores)
+        self.cond = threading.Condition()
+
+    def wait(self):
+        with self.cond:
+            generation = self.generation
+            self.arrived += 1
+            if self.arrived == self.live:
+                self.release()
+            while generation == self.generation:
+                self.cond.wait()
+
+    def leave(self):
+        with self.cond:
+            self.live -= 1
+            if self.arrived == self.live:
+                self.release()
+
+    def release(self):
+        self.merge()
+        self.arrived = 0
+        self.generation += 1
+        self.cond.notify_all()
+
+    def merge(self):
+        # two cores writing an addr, or one reading an addr another wrote, in
+        # the same epoch is a conflict, the program needs a BARRIER between them
+        writers = {}
+        for view in self.views:
+            for addr in view.writes:
+                writers.setdefault(addr, []).append(view.coreId)
+
+        for addr in sorted(writers):
+            if len(writers[addr]) > 1:
+                self.conflicts.append((self.epoch, addr, "write-write", writers[addr]))
+        for view in self.views:
+            for addr in sorted(view.reads & writers.keys()):
+                others = [core for core in writers[addr] if core != view.coreId]
+                if others:
+                    self.conflicts.append((self.epoch, addr, "read-write", [view.coreId] + others))
+
+        for view in self.views:
+            for addr, val in view.writes.items():
+                view.vdmem.Write(addr, val)
+            view.writes = {}
+            view.reads = set()
+        self.epoch += 1
+
+def coreFile(iodir, name, ext, coreId):
+    "name<coreId>.ext if it exists, else the shared name.ext"
+    perCore = f"{name}{coreId}{ext}"
+    return perCore if os.path.exists(os.path.join(iodir, perCore)) else name + ext
+
+def runCore(vcore, barrier, logfile, stdout, errors, coreId):
+    "host thread of a core"
+    try:
+        with open(logfile, 'w') as log:
+            stdout.setFile(log)
+            vcore.run()
+    except Exception as e:
+        errors[coreId] = e
+    finally:
+        barrier.leave()
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Vector Processor Multi-Core Simulator')
+    parser.add_argument('--iodir', default="", type=str, help='Path to the folder containing the input files - instructions and data.')
+    parser.add_argument('--cores', default=2, type=int, help="number of cores")
+    parser.add_argument('--dump', default="full", choices=["full", "delta"], help="save all of SDMEM/VDMEM, or only the words that changed")
+    args = parser.parse_args()
+
+    iodir = os.path.abspath(args.iodir)
+    print("IO Directory:", iodir)
+
+    config = Config(iodir)
+
+    # each core runs Code<i>.asm with SDMEM<i>.txt, or the shared Code.asm/SDMEM.txt
+    vdmem = DMEM("VDMEM", iodir, 17) # 512 KB is 2^19 bytes = 2^17 K 32-bit words.
+    views = [CoreVDMEM(vdmem, i) for i in range(args.cores)]
+    barrier = SharedMemoryBarrier(views)
+    cores, sdmems = [], []
+    for i in range(args.cores):
+        codefile = coreFile(iodir, "Code", ".asm", i)
+        verifyCode(os.path.join(iodir, codefile))
+        sdmem = DMEM(f"SDMEM{i}", iodir, 13, ipname=coreFile(iodir, "SDMEM", ".txt", i)[:-len(".txt")])
+        cores.append(Core(IMEM(iodir, codefile), sdmem, views[i], barrier=barrier))
+        sdmems.append(sdmem)
+
+    print(f"Running func simulator on {args.cores} cores...")
+    stdout = sys.stdout
+    sys.stdout = ThreadStdout(stdout)
+    errors = {}
+    threads = [threading.Thread(target=runCore, args=(vcore, barrier, f"out{i}.txt", sys.stdout, errors, i))
+               for i, vcore in enumerate(cores)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    sys.stdout = stdout
+    if errors:
+        raise RuntimeError(f"core {min(errors)} failed") from errors[min(errors)]
+    print("Saved output of func simulator in out<core>.txt")
+
+    for i, vcore in enumerate(cores):
+        vcore.dumpregs(iodir, suffix=str(i))
+    for dmem in sdmems + [vdmem]:
+        if args.dump == "delta":
+            dmem.dumpDelta()
+        else:
+            dmem.dump()
+
+    conflictfp = os.path.join(iodir, "VDMEMconflicts.txt")
+    with open(conflictfp, 'w') as f:
+        for epoch, addr, kind, coreIds in barrier.conflicts:
+            f.write(f"epoch {epoch} addr {addr} {kind} cores {' '.join(map(str, coreIds))}\n")
+    print(f"VDMEM conflicts: {len(barrier.conflicts)} (saved in {conflictfp})")
+
+    print(f"Running timing simulator ({config.parameters.get('issueMode', 'inorder')} issue)...")
+    traces = [[vcore.trace.tagged(i) for i in range(len(vcore.trace.lines))] for vcore in cores]
+    ts = MultiCoreTimingSim(traces, config)
+    ts.run()
+    print(f"Cycles: {ts.cyclesTaken()}")
+    ts.printStats()
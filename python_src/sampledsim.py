@@ -0,0 +1,172 @@
+"""
+VMIPS Vector Processor Sampled Timing Simulator
+Splits the dynamic trace into fixed size intervals, clusters them by their
+basic block and opcode mix vectors (SimPoint style), runs the timing simulator
+only on a few intervals of each cluster and extrapolates the total cycles.
+Authors: Gaurav Kuwar, Ritvik Nair
+"""
+
+import os
+import time
+import random
+import argparse
+from contextlib import redirect_stdout
+
+from verify_program import verifyCode
+from funcsimulator import IMEM, DMEM, Core
+from timingsimulator import Config, TimingSim, OoOTimingSim
+
+class IntervalTrace:
+    """
+    Trace lines of one interval after its warm-up lines, followed by HALT.
+    Records the cycle the first instr of the interval is fetched and the cycle
+    HALT is fetched, so the cycles of the interval don't include the warm-up or the drain.
+    """
+    def __init__(self, lines, warmup):
+        self.lines = lines
+        self.warmup = warmup # number of warm-up lines at the start
+        self.ts = None
+        self.startCycle = None
+        self.endCycle = None
+
+    def __iter__(self):
+        for i, line in enumerate(self.lines):
+            if i == self.warmup:
+                self.startCycle = self.ts.cycle
+            yield line
+        self.endCycle = self.ts.cycle
+        yield "HALT"
+
+def simulateInterval(lines, start, end, warmup, config):
+    "returns (cycles of lines[start:end], cycles to drain after the last fetch)"
+    warmStart = max(start - warmup, 0)
+    trace = IntervalTrace(lines[warmStart:end], start - warmStart)
+    issueMode = config.parameters.get("issueMode", "inorder")
+    ts = OoOTimingSim(trace, config) if issueMode == "ooo" else TimingSim(trace, config)
+    trace.ts = ts
+    ts.run()
+    return trace.endCycle - trace.startCycle, ts.cyclesTaken() - trace.endCycle
+
+def dist2(a, b):
+    return sum((x - y) ** 2 for x, y in zip(a, b))
+
+def kmeans(points, k, rng, maxIters=100):
+    "returns (assignment of each point, centroids, sum of squared distances)"
+    # k-means++ init
+    centroids = [points[rng.randrange(len(points))]]
+    while len(centroids) < k:
+        d = [min(dist2(p, c) for c in centroids) for p in points]
+        if sum(d) == 0: break
+        centroids.append(points[rng.choices(range(len(points)), weights=d)[0]])
+
+    assignment = None
+    for _ in range(maxIters):
+        newAssignment = [min(range(len(centroids)), key=lambda c: dist2(p, centroids[c])) for p in points]
+        if newAssignment == assignment: break
+        assignment = newAssignment
+        for c in range(len(centroids)):
+            members = [p for p, a in zip(points, assignment) if a == c]
+            if members:
+                centroids[c] = [sum(col) / len(members) for col in zip(*members)]
+
+    sse = sum(dist2(p, centroids[a]) for p, a in zip(points, assignment))
+    return assignment, centroids, sse
+
+def cluster(vectors, maxClusters, seed=0):
+    """
+    Clusters the interval vectors, each normalized by its instr count.
+    Like SimPoint, picks the smallest k that gets 90% of the best drop in
+    squared error over k = 1..maxClusters
+    """
+    keys = sorted({key for vec in vectors for key in vec}, key=str)
+    points = []
+    for vec in vectors:
+        total = sum(v for key, v in vec.items() if key[0] == "op") or 1
+        points.append([vec.get(key, 0) / total for key in keys])
+
+    runs = [kmeans(points, k, random.Random(seed)) for k in range(1, min(maxClusters, len(points)) + 1)]
+    sse1, sseBest = runs[0][2], min(run[2] for run in runs)
+    for assignment, centroids, sse in runs:
+        if sse1 - sse >= 0.9 * (sse1 - sseBest):
+            return assignment, centroids, points
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Vector Processor Sampled Timing Simulator')
+    parser.add_argument('--iodir', default="", type=str, help='Path to the folder containing the input files - instructions and data.')
+    parser.add_argument('--interval', default=500, type=int, help="dynamic instrs per interval")
+    parser.add_argument('--warmup', default=100, type=int, help="instrs simulated before each sampled interval to warm up queues, units and banks")
+    parser.add_argument('--max-clusters', default=8, type=int, help="max number of clusters")
+    parser.add_argument('--validate', default=False, action='store_true', help="also run the whole trace and print the real error")
+    args = parser.parse_args()
+
+    iodir = os.path.abspath(args.iodir)
+    print("IO Directory:", iodir)
+
+    config = Config(iodir)
+
+    # func sim, keeps the trace in memory
+    verifyCode(os.path.abspath(os.path.join(iodir, "Code.asm")))
+    imem = IMEM(iodir)
+    sdmem = DMEM("SDMEM", iodir, 13)
+    vdmem = DMEM("VDMEM", iodir, 17)
+    vcore = Core(imem, sdmem, vdmem)
+
+    print("Running func simulator...")
+    with open("out.txt", 'w') as log, redirect_stdout(log):
+        vcore.run()
+    print("Saved output of func simulator in out.txt")
+    vcore.dumpregs(iodir)
+    sdmem.dump()
+    vdmem.dump()
+
+    trace = vcore.trace
+    lines = [trace.tagged(i) for i in range(len(trace.lines) - 1)] # without HALT
+    if not lines:
+        parser.exit(message="Trace has no instrs before HALT, nothing to sample\n")
+    intervals = [(start, min(start + args.interval, len(lines))) for start in range(0, len(lines), args.interval)]
+    vectors = trace.intervalVectors(args.interval)[:len(intervals)]
+
+    assignment, centroids, points = cluster(vectors, args.max_clusters)
+    print(f"Intervals: {len(intervals)} of {args.interval} instrs, clusters: {len(centroids)}")
+
+    # each cluster is estimated from the interval closest to its centroid, the interval
+    # farthest from that one is also run and bounds how far the other members can be off
+    clusters = []
+    for c, centroid in enumerate(centroids):
+        members = [i for i, a in enumerate(assignment) if a == c]
+        if not members: continue
+        rep = min(members, key=lambda i: dist2(points[i], centroid))
+        far = max(members, key=lambda i: dist2(points[i], points[rep]))
+        clusters.append((members, rep, far))
+
+    startTime = time.time()
+    cpi, drains, simulated = {}, [], 0
+    for idx in sorted({i for _, rep, far in clusters for i in (rep, far)}):
+        start, end = intervals[idx]
+        cycles, drain = simulateInterval(lines, start, end, args.warmup, config)
+        cpi[idx] = cycles / (end - start)
+        drains.append(drain)
+        simulated += end - max(start - args.warmup, 0)
+
+    estimate, bound = 0, 0
+    for c, (members, rep, far) in enumerate(clusters):
+        instrs = sum(intervals[i][1] - intervals[i][0] for i in members)
+        estimate += cpi[rep] * instrs
+        bound += abs(cpi[far] - cpi[rep]) * instrs
+        print(f"Cluster {c}: {len(members)} intervals, representative {rep} (CPI {cpi[rep]:.3f}), farthest {far} (CPI {cpi[far]:.3f})")
+
+    estimate += sum(drains) / len(drains) # the drain after the last fetch
+    sampledTime = time.time() - startTime
+
+    print(f"Simulated {simulated} of {len(lines)} instrs ({100 * simulated / max(len(lines), 1):.1f}%) in {sampledTime:.1f}s")
+    print(f"Estimated cycles: {estimate:.0f} +/- {bound:.0f} ({100 * bound / estimate:.1f}%)")
+
+    if args.validate:
+        startTime = time.time()
+        fullTrace = IntervalTrace(lines, 0)
+        issueMode = config.parameters.get("issueMode", "inorder")
+        ts = OoOTimingSim(fullTrace, config) if issueMode == "ooo" else TimingSim(fullTrace, config)
+        fullTrace.ts = ts
+        ts.run()
+        error = 100 * (estimate - ts.cyclesTaken()) / ts.cyclesTaken()
+        print(f"Cycles: {ts.cyclesTaken()} in {time.time() - startTime:.1f}s, error of estimate: {error:+.2f}%")
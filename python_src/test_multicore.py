@@ -0,0 +1,72 @@
+"""
+checks multicore.py on a real program: dot_product_multicore splits the dot
+product across 2 cores with a BARRIER between the partial sums and their sum,
+and must give the same result as dot_product on one core. Without the BARRIER
+the read of the other core's partial sum must be reported as a conflict.
+Run from anywhere: python3 test_multicore.py
+"""
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+SRC_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SRC_DIR)
+RESULT_ADDR = 2048
+
+def run(script, iodir, *args):
+    # the simulators write their logs to the working dir, keep them in the temp dir
+    subprocess.run([sys.executable, os.path.join(SRC_DIR, script), "--iodir", iodir, *args],
+                   cwd=os.path.dirname(iodir), check=True, stdout=subprocess.DEVNULL)
+
+def readWords(fp):
+    with open(fp) as f:
+        return [int(line) for line in f]
+
+def copyWorkload(tmp, name):
+    iodir = os.path.join(tmp, name)
+    shutil.copytree(os.path.join(REPO_DIR, name), iodir)
+    return iodir
+
+def singleCoreResult(tmp):
+    iodir = copyWorkload(tmp, "dot_product")
+    run("funcsimulator.py", iodir)
+    return readWords(os.path.join(iodir, "VDMEMOP.txt"))[RESULT_ADDR]
+
+def multiCoreRun(tmp, name, withBarrier=True):
+    "result and conflict lines of dot_product_multicore on 2 cores"
+    iodir = copyWorkload(tmp, name)
+    if not withBarrier:
+        codefp = os.path.join(iodir, "Code.asm")
+        with open(codefp) as f:
+            code = [line for line in f if not line.startswith("BARRIER")]
+        with open(codefp, 'w') as f:
+            f.writelines(code)
+    run("multicore.py", iodir, "--cores", "2")
+
+    with open(os.path.join(iodir, "VDMEMconflicts.txt")) as f:
+        conflicts = f.read().splitlines()
+    return readWords(os.path.join(iodir, "VDMEMOP.txt"))[RESULT_ADDR], conflicts
+
+def test_split_dot_product(tmp):
+    vdmem = readWords(os.path.join(REPO_DIR, "dot_product_multicore", "VDMEM.txt"))
+    expected = sum(a * b for a, b in zip(vdmem[:450], vdmem[450:900]))
+
+    single = singleCoreResult(tmp)
+    multi, conflicts = multiCoreRun(tmp, "dot_product_multicore")
+    assert single == expected, f"single core gave {single}, expected {expected}"
+    assert multi == single, f"2 cores gave {multi}, 1 core gave {single}"
+    assert conflicts == [], f"unexpected conflicts: {conflicts}"
+
+def test_missing_barrier(tmp):
+    # core 0 reads core 1's partial sum (addr 2050) in the epoch core 1 writes it
+    multi, conflicts = multiCoreRun(tmp, "dot_product_multicore", withBarrier=False)
+    assert "epoch 0 addr 2050 read-write cores 0 1" in conflicts, f"conflict not reported: {conflicts}"
+    assert multi != singleCoreResult(tmp), "the result should miss core 1's partial sum"
+
+if __name__ == "__main__":
+    for test in (test_split_dot_product, test_missing_barrier):
+        with tempfile.TemporaryDirectory() as tmp:
+            test(tmp)
+        print(test.__name__, "passed")
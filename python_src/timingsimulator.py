@@ -4,7 +4,9 @@ Authors: Gaurav Kuwar, Ritvik Nair
 """
 
 import os
+import re
 import argparse
+from verify_program import rmComments
 
 # Constants
 REG_COUNT = 8
@@ -14,11 +16,15 @@ MAX_VECTOR_LEN = 64
 allVecComputeInstrs = {'ADDVV', 'SUBVV', 'MULVV', 'DIVVV', 'UNPACKHI', 'UNPACKLO', 'PACKLO', 'PACKHI',
                        'ADDVS', 'SUBVS', 'MULVS', 'DIVVS',
                        'SEQVV', 'SNEVV', 'SGTVV', 'SLTVV', 'SGEVV', 'SLEVV',
-                       'SEQVS', 'SNEVS', 'SGTVS', 'SLTVS', 'SGEVS', 'SLEVS'}
+                       'SEQVS', 'SNEVS', 'SGTVS', 'SLTVS', 'SGEVS', 'SLEVS',
+                       'MACW'}
 
 vectorMaskRegOps = {'SEQVV', 'SNEVV', 'SGTVV', 'SLTVV', 'SGEVV', 'SLEVV',
                     'SEQVS', 'SNEVS', 'SGTVS', 'SLTVS', 'SGEVS', 'SLEVS'}
 
+vectorLoadInstrs = {'LV', 'LVWS', 'LVI'}
+vectorStoreInstrs = {'SV', 'SVWS', 'SVI', 'SVN'}
+
 # HELPERS
 def ceil(x):
     # custom ceil func, since we can't use libraries
@@ -34,6 +40,9 @@ def regIdx(reg):
     offset = REG_COUNT if reg[0] == "S" else 0
     return int(reg[2:]) + offset
 
+def isHalt(instrStr):
+    return instrStr.split('#')[0].strip() == "HALT"
+
 def isReg(op): # checks if the operand is a reg val
     return type(op) == str and (op.startswith("SR") or op.startswith("VR")) and op[2:].isdigit()
 
@@ -41,7 +50,7 @@ def instr2Func(instr):
     if (instr.name in {'ADDVV', 'ADDVS', 'SUBVV', 'SUBVS'} or 
         instr.name in vectorMaskRegOps):
         return "ADD"
-    if instr.name in {"MULVV", "MULVS"}:
+    if instr.name in {"MULVV", "MULVS", "MACW"}:
         return "MUL"
     if instr.name in {"DIVVV", "DIVVS"}:
         return "DIV"
@@ -55,7 +64,7 @@ class Queue:
         self.q = []
 
     def pop(self):
-        return self.q.pop(-1) if not self.empty() else None
+        return self.q.pop(0) if not self.empty() else None
 
     def push(self, val):
         if self.full(): return 1
@@ -74,7 +83,19 @@ class Queue:
 class Instr:
     """Intruction Object"""
     def __init__(self, instrStr):
-        self.instrStr = instrStr
+        # trace lines are tagged with the static PC of the instr, ex. "ADD SR1 SR1 SR2 # 12"
+        self.pc = None
+        if '#' in instrStr:
+            instrStr, pc = instrStr.split('#', 1)
+            self.pc = int(pc)
+
+        # packed vector instrs end with their element width, ex. "ADDVV VR1 VR2 VR3 256 e8"
+        self.ew = REG_BITS
+        if re.fullmatch(r"e\d+", instrStr.split()[-1]):
+            instrStr, ew = instrStr.rsplit(maxsplit=1)
+            self.ew = int(ew[1:])
+
+        self.instrStr = instrStr.strip()
         self.name = instrStr.split()[0]
         
         if self.isVecMem() or self.isScalarMem():
@@ -86,11 +107,20 @@ class Instr:
             
             self.op2 = [int(a) for a in addrs.strip()[1:-1].split(sep=',') if len(a) > 0] # convert addrs from str to list
         else:
-            _, self.op1, self.op2, self.op3, self.vlen = padding(instrStr.split())
+            parts = instrStr.split()
+            if self.name in allVecComputeInstrs and parts[-1].isdigit(): # S__VV/S__VS have 2 regs before the vlen
+                parts, self.vlen = parts[:-1], parts[-1]
+            else:
+                self.vlen = None
+            _, self.op1, self.op2, self.op3 = padding(parts, 4)
 
         if self.vlen:
             self.vlen = int(self.vlen)
 
+    def laneWork(self):
+        "number of 32 bit lane ops, packed elements share a lane op"
+        return ceil(self.vlen * self.ew / REG_BITS)
+
     def isVecMem(self):
         return self.name.startswith('LV') or self.name.startswith('SV')
 
@@ -100,6 +130,12 @@ class Instr:
     def isScalarMem(self):
         return self.name in {"LS", "SS"}
 
+    def addrSet(self):
+        "set of VDMEM addrs accessed, for checking overlaps between mem instrs"
+        if not hasattr(self, "_addrSet"):
+            self._addrSet = set(self.op2)
+        return self._addrSet
+
     def __repr__(self):
         return f"{(self.name, self.op1, self.op2, self.op3, self.vlen)}"
 
@@ -130,7 +166,7 @@ class BusyBoard:
             self.bb[-2] = 1
         
         # for vector len
-        if instr.name in {"MTCL", "MFCL"}:
+        if instr.name in {"MTCL", "MFCL", "MTEW", "MFEW"}:
             self.bb[-1] = 1
         
         for op in (instr.op1, instr.op2, instr.op3):
@@ -144,7 +180,7 @@ class BusyBoard:
             self.bb[-2] = 0
         
         # for vector len
-        if instr.name in {"MTCL", "MFCL"}:
+        if instr.name in {"MTCL", "MFCL", "MTEW", "MFEW"}:
             self.bb[-1] = 0
             
         for op in (instr.op1, instr.op2, instr.op3):
@@ -197,21 +233,50 @@ class VectorComputeUnit:
                 
             # print(self.lanes)
 
+class VDMBanks:
+    """
+    VDMEM banks, can be shared by many vector data units.
+    When shared, the order the units are updated in decides who gets a bank (arbitration)
+    """
+    def __init__(self, numOfBanks, bankBusyTime):
+        # VDM is total 512000 bytes split across numOfBanks
+        self.busy = [0] * numOfBanks
+        self.numOfBanks = numOfBanks
+        self.bankBusyTime = bankBusyTime
+
+    def request(self, addr):
+        "claims the bank of addr, returns False if the bank wasn't free"
+        # this formula allows us to map the specific addr to its bank
+        bankIdx = addr % self.numOfBanks
+
+        if self.busy[bankIdx] == 0:
+            self.busy[bankIdx] = self.bankBusyTime
+            return True
+        return False
+
+    def update(self):
+        for bankIdx in range(self.numOfBanks):
+            if self.busy[bankIdx] > 0:
+                self.busy[bankIdx] -= 1
+
 class VectorDataUnit:
     """
     Goes cycle by cycle per pipeline stage in each lane, and then banks are decoupled
     So any lane can access any bank
     """
-    def __init__(self, pipelineDepth, numOfLanes, numOfBanks, bankBusyTime):
+    def __init__(self, pipelineDepth, numOfLanes, numOfBanks, bankBusyTime, banks=None):
         self.lanes = [[None]*pipelineDepth for _ in range(numOfLanes)] # each row is stages in the lanes
         self.addrs = []
         self.i = 0 # vector index
         self.instr = None
 
-        # VDM is total 512000 bytes split across numOfBanks
-        self.banks = [0] * numOfBanks
-        self.numOfBanks = numOfBanks
-        self.bankBusyTime = bankBusyTime
+        # banks are updated by the owner, so shared banks are updated once a cycle
+        self.ownsBanks = banks is None
+        self.banks = VDMBanks(numOfBanks, bankBusyTime) if banks is None else banks
+
+        # stats
+        self.busyCycles = 0
+        self.bankStalls = 0
 
     def inputVec(self, addrs):
         self.i = 0
@@ -226,21 +291,13 @@ class VectorDataUnit:
 
     def update(self):
         if self.busy() or len(self.addrs) > self.i:
+            self.busyCycles += 1
             for laneIdx in range(len(self.lanes)):
                 stalled = False
                 if self.lanes[laneIdx][-1] is not None:
-                    # this formula allows us to map the specific addr to its bank
-                    addr = self.lanes[laneIdx][-1]
-                    bankIdx = addr % self.numOfBanks
-        
-                    # check if the bank is free
-                    if self.banks[bankIdx] == 0: 
-                        self.banks[bankIdx] = self.bankBusyTime 
-                        
-                        # we stalled if the bank wasnt free
-                        stalled = False
-                    else:
-                        stalled = True
+                    # we stalled if the bank wasnt free
+                    stalled = not self.banks.request(self.lanes[laneIdx][-1])
+                    self.bankStalls += stalled
 
                 if not stalled:
                     popped = shift(self.lanes[laneIdx])
@@ -251,12 +308,11 @@ class VectorDataUnit:
                 self.i += 1
     
             # print(self.lanes)
-            # print(self.banks)
+            # print(self.banks.busy)
             
-            # update bank state
-            for bankIdx in range(self.numOfBanks):
-                if self.banks[bankIdx] > 0:
-                    self.banks[bankIdx] -= 1
+        # update bank state
+        if self.ownsBanks:
+            self.banks.update()
 
 class Config(object):
     def __init__(self, iodir):
@@ -272,12 +328,80 @@ class Config(object):
             print("Config - ERROR: Couldn't open file in path:", self.filepath)
             raise
 
+class Profiler:
+    """
+    Cycles attributed to each static instr (PC) of Code.asm, split into
+    stall (waiting in decode), queue (waiting to start in a unit) and exec.
+    Instrs overlap, so the sum over all PCs is more than the total cycles.
+    """
+    stages = ("stall", "queue", "exec")
+
+    def __init__(self):
+        self.cycles = {} # pc -> [stall, queue, exec]
+        self.count = {}  # pc -> dynamic instr count
+
+    def record(self, instr, cycle):
+        if instr.pc is None: return # trace without PCs
+
+        stages = self.cycles.setdefault(instr.pc, [0, 0, 0])
+        stages[0] += instr.stallCycles
+        stages[1] += instr.startCycle - instr.dispatchCycle - 1
+        stages[2] += cycle - instr.startCycle + 1
+        self.count[instr.pc] = self.count.get(instr.pc, 0) + 1
+
+    def loops(self, code):
+        "(start, end) PCs of each loop (backward branch), outer loops first"
+        loops = []
+        for pc, (_, instr) in enumerate(code):
+            name, *ops = instr.split()
+            if name.startswith("B") and name != "BARRIER" and int(ops[-1]) < 0:
+                loops.append((pc + int(ops[-1]), pc))
+        return sorted(loops, key=lambda loop: loop[0] - loop[1])
+
+    def dump(self, iodir, totalCycles):
+        with open(os.path.join(iodir, "Code.asm")) as f:
+            lines = f.read().splitlines()
+
+        code = rmComments(lines, withLineNum=True) # PC -> (line num, instr)
+        pcOfLine = {lineNum: pc for pc, (lineNum, _) in enumerate(code)}
+        total = sum(sum(stages) for stages in self.cycles.values()) or 1
+
+        # annotated Code.asm listing
+        listingfp = os.path.join(iodir, "Code.annotated.asm")
+        with open(listingfp, 'w') as f:
+            f.write(f"# Total cycles: {totalCycles}, attributed cycles: {total} (instrs overlap)\n")
+            f.write(f"# {'count':>7} {'cycles':>9} {'%':>6} {'stall':>9} {'queue':>9} {'exec':>9} | Code.asm\n")
+            for lineNum, line in enumerate(lines, start=1):
+                pc = pcOfLine.get(lineNum)
+                if pc in self.cycles:
+                    stages = self.cycles[pc]
+                    f.write(f"  {self.count[pc]:>7} {sum(stages):>9} {100 * sum(stages) / total:>5.1f}% "
+                            f"{stages[0]:>9} {stages[1]:>9} {stages[2]:>9} | {line}\n")
+                else:
+                    f.write(f"  {'':>7} {'':>9} {'':>6} {'':>9} {'':>9} {'':>9} | {line}\n")
+        print("Saved annotated Code.asm in", listingfp)
+
+        # collapsed stacks (Code.asm;loop;instr;stage cycles), for flamegraph.pl or speedscope
+        foldedfp = os.path.join(iodir, "profile.folded")
+        loops = self.loops(code)
+        with open(foldedfp, 'w') as f:
+            for pc in sorted(self.cycles):
+                frames = ["Code.asm"]
+                frames += [f"loop L{code[start][0]}-L{code[end][0]}" for start, end in loops if start <= pc <= end]
+                frames.append(f"L{code[pc][0]} {code[pc][1]}")
+
+                for stage, cycles in zip(self.stages, self.cycles[pc]):
+                    if cycles > 0:
+                        f.write(f"{';'.join(frames)};{stage} {cycles}\n")
+        print("Saved collapsed stacks in", foldedfp)
+
 # main timing sim class
 class TimingSim:
-    def __init__(self, tracefp, config):
-
-        with open(tracefp) as f:
-            trace = f.read().splitlines()
+    def __init__(self, trace, config):
+        # trace is the path of trace.asm or an iterable of trace lines (ex. a TraceRing)
+        if isinstance(trace, str):
+            with open(trace) as f:
+                trace = f.read().splitlines()
 
         self.trace  = iter(trace)
         self.stallFetch = False
@@ -296,14 +420,33 @@ class TimingSim:
         self.scalarQ        = Queue(1)                 # all scalar ops (mem/ex)
 
         self.units = {func: VectorComputeUnit(self.pipelineDepth[func], int(config.parameters["numLanes"])) for func in ('ADD', 'MUL', 'DIV', 'SHF')} 
-        self.vdata = VectorDataUnit(int(config.parameters["vlsPipelineDepth"]), 
-                                    int(config.parameters["numLanes"]), 
-                                    int(config.parameters["vdmNumBanks"]), 
-                                    int(config.parameters["vdmBankBusyTime"]))
+        # vector load/store units share the VDMEM banks
+        vlsParams = (int(config.parameters["vlsPipelineDepth"]), 
+                     int(config.parameters["numLanes"]), 
+                     int(config.parameters["vdmNumBanks"]), 
+                     int(config.parameters["vdmBankBusyTime"]))
+        self.banks = VDMBanks(*vlsParams[2:])
+        self.vdataUnits = [VectorDataUnit(*vlsParams, banks=self.banks) for _ in range(int(config.parameters.get("numVlsUnits", 1)))]
+        self.vdata = self.vdataUnits[0]
+        self.bankArbitration = config.parameters.get("vdmBankArbitration", "priority") # priority or roundrobin
+
+        # stores wait in the store buffer after reading their register, and are
+        # written by their own store unit, so loads don't have to wait for them
+        self.storeBufferDepth = int(config.parameters.get("storeBufferDepth", 0))
+        self.storeBuffer = []
+        self.storeUnit = VectorDataUnit(*vlsParams, banks=self.banks) if self.storeBufferDepth > 0 else None
+        self.storeBufferPeak = 0
         
         # cur scalar states
         self.s_remaining = 0
         self.s_instr = None
+
+        self.decodeStalls = 0 # cycles the instr in decode has stalled so far
+        self.profiler = None  # set to a Profiler to get per PC cycles
+
+        # multi-core, see MultiCoreTimingSim
+        self.ownsBanks = True # the banks are updated by the core that owns them
+        self.barrier = None   # without it BARRIER only waits for this core's instrs
     
     # Frontend Funcs
     def fetch(self):
@@ -313,10 +456,16 @@ class TimingSim:
     def decode(self, instrStr):
         instr = Instr(instrStr)
 
+        if instr.name == "BARRIER":
+            if not self.passBarrier(instr):
+                self.stallFetch = True
+                return False
+            return True
+
         # check if any registers are busy, and stall if they are
         if self.busyboard.regBusy(instr): # checks data hazards
             self.stallFetch = True
-            return
+            return False
 
         # set regs high on busy board
         self.busyboard.add(instr)
@@ -325,18 +474,57 @@ class TimingSim:
         if instr.isVecMem():                
             if self.vectorDataQ.push(instr) == 1:
                 self.stallFetch = True
-                # stall frontend
+                return False # stall frontend
 
         elif instr.isVecCompute():
             # Note: S__VV and S__VS are diff (op3) ??
             if self.vectorComputeQ.push(instr) == 1:
                 self.stallFetch = True
-                # stall frontend
+                return False # stall frontend
         
-        else: # scalar ops, CVM, POP, MTCL, MFCL
+        else: # scalar ops, CVM, POP, MTCL, MFCL, MTEW, MFEW
             if self.scalarQ.push(instr) == 1:
                 self.stallFetch = True
-                # stall frontend
+                return False # stall frontend
+
+        self.dispatched(instr)
+        return True
+
+    def passBarrier(self, instr):
+        "BARRIER waits for the instrs before it to finish, and for the other cores to reach theirs"
+        if not self.drained() or (self.barrier and not self.barrier.arrive(self)):
+            return False
+
+        # it doesn't go to a unit, the profiler counts it as one cycle of exec
+        self.dispatched(instr)
+        instr.startCycle = self.cycle + 1
+        if self.profiler:
+            self.profiler.record(instr, instr.startCycle)
+        return True
+
+    def shareBanks(self, banks):
+        "use VDMEM banks shared with other cores, the owner updates them once a cycle"
+        self.banks = banks
+        for unit in self.vdataUnits + ([self.storeUnit] if self.storeUnit else []):
+            unit.banks = banks
+        self.ownsBanks = False
+
+    # Profiling
+    # --------------
+    # Each instr keeps the cycles it stalled in decode, when it was dispatched
+    # into a queue and when it started in a unit. The profiler gets them
+    # when the instr finishes.
+
+    def dispatched(self, instr):
+        instr.stallCycles, self.decodeStalls = self.decodeStalls, 0
+        instr.dispatchCycle = self.cycle
+
+    def started(self, instr):
+        instr.startCycle = self.cycle
+
+    def finished(self, instr):
+        if self.profiler:
+            self.profiler.record(instr, self.cycle)
 
     
     # Backend Funcs
@@ -349,13 +537,77 @@ class TimingSim:
     # and stalling instructions when the required registers are busy
     # we resolve data hazards.
     
+    def memInFlight(self):
+        "vector mem instrs that started but haven't finished"
+        instrs = [unit.instr for unit in self.vdataUnits if unit.instr] + self.storeBuffer
+        if self.storeUnit and self.storeUnit.instr:
+            instrs.append(self.storeUnit.instr)
+        return instrs
+
+    def memConflict(self, instr):
+        "check if instr uses an addr of an in flight mem instr, and one of them is a store"
+        isStore = instr.name in vectorStoreInstrs
+        for other in self.memInFlight():
+            if (isStore or other.name in vectorStoreInstrs) and instr.addrSet() & other.addrSet():
+                return True
+        return False
+
+    def canStartMem(self, instr):
+        if self.storeUnit and instr.name in vectorStoreInstrs:
+            return len(self.storeBuffer) < self.storeBufferDepth
+        return any(not unit.busy() for unit in self.vdataUnits) and not self.memConflict(instr)
+
+    def startMem(self, instr, owner):
+        "start a vector mem instr, returns True if it went to the store buffer (so its regs are free)"
+        self.started(instr)
+        if self.storeUnit and instr.name in vectorStoreInstrs:
+            self.storeBuffer.append(instr)
+            self.storeBufferPeak = max(self.storeBufferPeak, len(self.storeBuffer))
+            return True
+
+        unit = next(unit for unit in self.vdataUnits if not unit.busy())
+        unit.inputVec(instr.op2)
+        unit.instr = owner
+        return False
+
+    def drainStoreBuffer(self):
+        if not self.storeUnit or self.storeUnit.busy() or not self.storeBuffer: return
+
+        # don't overtake loads of the same addrs that are still running
+        instr = self.storeBuffer[0]
+        for other in self.memInFlight():
+            if other.name in vectorLoadInstrs and instr.addrSet() & other.addrSet():
+                return
+
+        self.storeUnit.inputVec(instr.op2)
+        self.storeUnit.instr = self.storeBuffer.pop(0)
+
+    def updateVectorMem(self):
+        "update the load/store units in arbitration order, units updated first get the banks first"
+        units = self.vdataUnits + ([self.storeUnit] if self.storeUnit else [])
+        if self.bankArbitration == "roundrobin":
+            first = self.cycle % len(units)
+            units = units[first:] + units[:first]
+
+        for unit in units:
+            unit.update()
+        if self.ownsBanks:
+            self.banks.update()
+
+        if self.storeUnit and self.storeUnit.instr and not self.storeUnit.busy():
+            self.finished(self.storeUnit.instr)
+            self.storeUnit.instr = None
+
+    def vectorMemBusy(self):
+        return len(self.memInFlight()) > 0 or any(unit.busy() for unit in self.vdataUnits)
+
     def handleVectorMem(self):
-        # pop from queue if unit is not busy
-        if self.vectorDataQ.empty() or self.vdata.busy(): return
+        # pop from queue if a unit is not busy (or the store buffer has space)
+        if self.vectorDataQ.empty() or not self.canStartMem(self.vectorDataQ.head()): return
             
         instr = self.vectorDataQ.pop()
-        self.vdata.inputVec(instr.op2)
-        self.vdata.instr = instr
+        if self.startMem(instr, instr):
+            self.busyboard.clear(instr) # store data was read into the store buffer
 
     def handleFuncUnits(self):
         # changes state of func unit if it is free to run an instr
@@ -367,8 +619,9 @@ class TimingSim:
         if self.units[funcUnit].busy(): return
             
         instr = self.vectorComputeQ.pop()
-        self.units[funcUnit].inputVec(instr.vlen)        
+        self.units[funcUnit].inputVec(instr.laneWork())        
         self.units[funcUnit].instr = instr
+        self.started(instr)
 
     def handleScalar(self):
         # changes state of scalar unit if it is free to run an instr
@@ -379,15 +632,15 @@ class TimingSim:
         # print("EX SCALAR: ", instr.instrStr)
         self.s_remaining = 1
         self.s_instr = instr
+        self.started(instr)
     
-    def stop(self):
-        "stop simulator when no pipelines running and nothing in queue"
-        if not (self.instrBuf == "HALT" and
-                self.scalarQ.empty() and
+    def drained(self):
+        "no pipelines running and nothing in queue"
+        if not (self.scalarQ.empty() and
                 self.vectorComputeQ.empty() and 
                 self.vectorDataQ.empty() and
                 self.s_remaining == 0 and
-                not self.vdata.busy()):
+                not self.vectorMemBusy()):
             return False
         
         for func in self.units:
@@ -396,80 +649,508 @@ class TimingSim:
                 
         return True
 
+    def reachedHalt(self):
+        return self.instrBuf is not None and isHalt(self.instrBuf)
+
+    def stop(self):
+        "stop simulator when HALT was fetched and everything before it is done"
+        return self.reachedHalt() and self.drained()
+
     def run(self):
         self.cycle = 0
         
         while not self.stop():
-            self.cycle += 1
-            # print("CYCLE:", self.cycle)
+            self.step()
             
-            # backend
-            self.handleVectorMem()
-            self.handleFuncUnits()
-            self.handleScalar()
-
-            # update states here
-            self.s_remaining = max(self.s_remaining - 1, 0)
-            if self.s_instr and self.s_remaining == 0:
-                self.busyboard.clear(self.s_instr)
-                self.s_instr = None
+        return self.cycle
+
+    def step(self):
+        "simulate one cycle"
+        self.cycle += 1
+        # print("CYCLE:", self.cycle)
         
-            self.vdata.update()
-            if self.vdata.instr and not self.vdata.busy():
-                self.busyboard.clear(self.vdata.instr)
-                self.vdata.instr = None
+        # backend
+        self.handleVectorMem()
+        self.handleFuncUnits()
+        self.handleScalar()
+
+        # update states here
+        self.s_remaining = max(self.s_remaining - 1, 0)
+        if self.s_instr and self.s_remaining == 0:
+            self.busyboard.clear(self.s_instr)
+            self.finished(self.s_instr)
+            self.s_instr = None
+    
+        self.drainStoreBuffer()
+        self.updateVectorMem()
+        for unit in self.vdataUnits:
+            if unit.instr and not unit.busy():
+                self.busyboard.clear(unit.instr)
+                self.finished(unit.instr)
+                unit.instr = None
+        
+        for func in self.units:
+            self.units[func].update()
             
-            for func in self.units:
-                self.units[func].update()
-                
-                if self.units[func].instr and not self.units[func].busy():
-                    self.busyboard.clear(self.units[func].instr)
-                    self.units[func].instr = None
+            if self.units[func].instr and not self.units[func].busy():
+                self.busyboard.clear(self.units[func].instr)
+                self.finished(self.units[func].instr)
+                self.units[func].instr = None
+        
+        # Frontend
+        # --------------
+        # decode stage
+        if not self.stallDecode:
+            # print("DS:", self.instrBuf) # DEBUG         
+            if not self.decode(self.instrBuf):
+                self.decodeStalls += 1
             
-            # Frontend
-            # --------------
-            # decode stage
-            if not self.stallDecode:
-                # print("DS:", self.instrBuf) # DEBUG         
-                self.decode(self.instrBuf)
-                
-                if self.instrBuf == "HALT":
-                    self.stallDecode = True
+            if isHalt(self.instrBuf):
+                self.stallDecode = True
 
-            # fetch stage
-            if not self.stallFetch:
-                self.instrBuf = self.fetch()
-                
-                # print("IF:", self.instrBuf) # DEBUG
-                
-                if self.instrBuf == "HALT":
-                    # stall fetch in the next cycle
-                    self.stallFetch = True
-                else:
-                    # decode the instr in next cycle
-                    # this is for when fetching first instr
-                    self.stallDecode = False
-                    
-            elif self.instrBuf != "HALT":
-                # if stalled in cur cycle, don't stall next cycle, but only if "HALT" isn't already reached
-                # this allows us to stall fetch, until decode stage doesn't stall it
-                self.stallFetch = False
-
-            # print("Scalar Q:", self.scalarQ.q) # DEBUG
-            # print("VecCom Q:", self.vectorComputeQ.q) # DEBUG
-            # print("VecDat Q:", self.vectorDataQ.q) # DEBUG
-            # print("BusyBoard", self.busyboard) # DEBUG
-            # print() # DEBUG
+        # fetch stage
+        if not self.stallFetch:
+            self.instrBuf = self.fetch()
+            
+            # print("IF:", self.instrBuf) # DEBUG
             
+            if isHalt(self.instrBuf):
+                # stall fetch in the next cycle
+                self.stallFetch = True
+            else:
+                # decode the instr in next cycle
+                # this is for when fetching first instr
+                self.stallDecode = False
+                
+        elif not isHalt(self.instrBuf):
+            # if stalled in cur cycle, don't stall next cycle, but only if "HALT" isn't already reached
+            # this allows us to stall fetch, until decode stage doesn't stall it
+            self.stallFetch = False
+
+        # print("Scalar Q:", self.scalarQ.q) # DEBUG
+        # print("VecCom Q:", self.vectorComputeQ.q) # DEBUG
+        # print("VecDat Q:", self.vectorDataQ.q) # DEBUG
+        # print("BusyBoard", self.busyboard) # DEBUG
+        # print() # DEBUG
+
+    def cyclesTaken(self):
+        return self.cycle
+
+    def printVectorMemStats(self):
+        units = [(f"VLS unit {idx}", unit) for idx, unit in enumerate(self.vdataUnits)]
+        if self.storeUnit:
+            units.append(("Store unit", self.storeUnit))
+
+        for name, unit in units:
+            print(f"{name}: busy {unit.busyCycles} cycles ({100 * unit.busyCycles / max(self.cycle, 1):.1f}%), bank stalls: {unit.bankStalls}")
+        if self.storeUnit:
+            print(f"Store buffer peak: {self.storeBufferPeak}/{self.storeBufferDepth}")
+
+# ---- Out-of-Order Issue ----
+# Enabled with `issueMode = ooo` in Config.txt. Decode renames registers and
+# dispatches into a reservation station per unit, each unit picks the oldest
+# ready entry, and instrs commit in order from a reorder buffer (ROB).
+# Vector registers are renamed onto a limited pool of physical registers,
+# scalar/length/mask regs are renamed onto ROB tags (like Tomasulo), so only
+# true dependencies wait. WAR/WAW hazards don't stall decode anymore.
+
+shuffleInstrs = {'PACKLO', 'PACKHI', 'UNPACKLO', 'UNPACKHI'}
+
+def instrRegs(instr, maskClear=True):
+    """
+    returns (dsts, srcs), the arch regs an instr writes and reads.
+    VLR is the vector length register and VMR is the vector mask register.
+    Masked writes also read the old dst, unless the mask is known to be cleared.
+    Note: base/index regs of memory ops are already resolved to addrs in the trace
+    """
+    name = instr.name
+    regs = [op for op in (instr.op1, instr.op2, instr.op3) if isReg(op)]
+    oldDst = [] if maskClear else regs[:1]
+
+    if name in vectorLoadInstrs:
+        dsts, srcs = regs[:1], ["VLR", "VMR"] + oldDst
+    elif name in vectorStoreInstrs:
+        dsts, srcs = [], regs[:1] + ["VLR", "VMR"]
+    elif name in vectorMaskRegOps:
+        dsts, srcs = ["VMR"], regs + ["VLR"]
+    elif name in shuffleInstrs:
+        dsts, srcs = regs[:1], regs[1:] + ["VLR"]
+    elif name == "MACW": # accumulates into its dst
+        dsts, srcs = regs[:1], regs + ["VLR", "VMR"]
+    elif name in allVecComputeInstrs:
+        dsts, srcs = regs[:1], regs[1:] + ["VLR", "VMR"] + oldDst
+    elif name == "CVM":
+        dsts, srcs = ["VMR"], []
+    elif name == "POP":
+        dsts, srcs = regs, ["VMR"]
+    elif name in {"MTCL", "MTEW"}: # MTEW also sets VLR to the max vector len
+        dsts, srcs = ["VLR"], regs
+    elif name in {"MFCL", "MFEW"}:
+        dsts, srcs = regs, ["VLR"]
+    elif name == "SS":
+        dsts, srcs = [], regs
+    else: # LS, scalar alu ops, B, HALT
+        dsts, srcs = regs[:1], regs[1:]
+
+    # VR0 and SR0 are hardwired to 0, so writes to them are dropped
+    dsts = [reg for reg in dsts if reg not in {"VR0", "SR0"}]
+    return dsts, srcs
+
+class RenameTable:
+    """
+    Maps arch regs to physical tags. Tags [0:numPhysVecRegs] are the physical
+    vector registers, the rest are unbounded tags for scalar/length/mask regs.
+    """
+    def __init__(self, numPhysVecRegs):
+        if numPhysVecRegs <= REG_COUNT:
+            raise ValueError(f"numPhysVecRegs must be more than {REG_COUNT}, got {numPhysVecRegs}")
+
+        self.numPhysVecRegs = numPhysVecRegs
+        self.freeVec = list(range(REG_COUNT, numPhysVecRegs))
+        self.nextTag = numPhysVecRegs
+        self.ready = {}
+        self.map = {}
+
+        for i in range(REG_COUNT):
+            self.map[f"VR{i}"] = i
+            self.ready[i] = True
+
+        for reg in [f"SR{i}" for i in range(REG_COUNT)] + ["VLR", "VMR"]:
+            self.map[reg] = self.nextTag
+            self.ready[self.nextTag] = True
+            self.nextTag += 1
+
+        self.peakVecInUse = REG_COUNT
+
+    def canRename(self, dsts):
+        return sum(reg.startswith("VR") for reg in dsts) <= len(self.freeVec)
+
+    def lookup(self, reg):
+        return self.map[reg]
+
+    def rename(self, reg):
+        "maps reg to a new tag, returns (new, old) tags"
+        old = self.map[reg]
+        if reg.startswith("VR"):
+            new = self.freeVec.pop(0)
+            self.peakVecInUse = max(self.peakVecInUse, self.vecInUse())
+        else:
+            new = self.nextTag
+            self.nextTag += 1
+
+        self.ready[new] = False
+        self.map[reg] = new
+        return new, old
+
+    def release(self, tag):
+        "called on commit for the tag that was overwritten"
+        if tag < self.numPhysVecRegs:
+            self.freeVec.append(tag)
+        else:
+            del self.ready[tag]
+
+    def vecInUse(self):
+        return self.numPhysVecRegs - len(self.freeVec)
+
+class RobEntry:
+    def __init__(self, instr, unit):
+        self.instr = instr
+        self.unit = unit
+        self.srcs = [] # tags
+        self.dsts = [] # (new, old) tags
+        self.done = False
+
+    def isMem(self):
+        return self.instr.isVecMem() or self.instr.isScalarMem()
+
+class ReservationStation:
+    def __init__(self, size):
+        self.size = size
+        self.entries = []
+
+    def full(self):
+        return len(self.entries) == self.size
+
+    def push(self, entry):
+        self.entries.append(entry)
+
+    def select(self, isReady):
+        """
+        pops the oldest ready entry, memory ops are kept in program order
+        between themselves, since we don't do memory disambiguation
+        """
+        memBlocked = False
+        for entry in self.entries:
+            if entry.isMem() and memBlocked:
+                continue
+            if isReady(entry):
+                self.entries.remove(entry)
+                return entry
+            if entry.isMem():
+                memBlocked = True
+        return None
+
+class OoOTimingSim(TimingSim):
+    def __init__(self, trace, config):
+        super().__init__(trace, config)
+        params = config.parameters
+
+        self.renameTable = RenameTable(int(params.get("numPhysVecRegs", 16)))
+        self.robDepth = int(params.get("robDepth", 16))
+        self.rob = []
+
+        rsDepthKeys = {'ADD': "rsDepthAdd", 'MUL': "rsDepthMul", 'DIV': "rsDepthDiv", 
+                       'SHF': "rsDepthShuffle", 'VLS': "rsDepthData", 'SCALAR': "rsDepthScalar"}
+        self.rs = {unit: ReservationStation(int(params.get(key, 4))) for unit, key in rsDepthKeys.items()}
+
+        self.maskClear = True # mask is all 1s after CVM (and on reset)
+        self.halted = False
+        self.stalls = {"rob": 0, "rs": 0, "rename": 0, "barrier": 0}
+
+    def memInFlight(self):
+        # the load/store units hold ROB entries
+        return [instr.instr if isinstance(instr, RobEntry) else instr for instr in super().memInFlight()]
+
+    def unitOf(self, instr):
+        if instr.isVecMem(): return 'VLS'
+        if instr.isVecCompute(): return instr2Func(instr)
+        return 'SCALAR'
+
+    # Frontend Funcs
+    def decode(self, instrStr):
+        "rename and dispatch instr, returns False if decode stalled"
+        instr = Instr(instrStr)
+        if instr.name == "BARRIER":
+            if not self.passBarrier(instr):
+                self.stalls["barrier"] += 1
+                return False
+            return True
+
+        unit = self.unitOf(instr)
+        dsts, srcs = instrRegs(instr, self.maskClear)
+
+        if len(self.rob) == self.robDepth:
+            self.stalls["rob"] += 1
+            return False
+        if self.rs[unit].full():
+            self.stalls["rs"] += 1
+            return False
+        if not self.renameTable.canRename(dsts):
+            self.stalls["rename"] += 1
+            return False
+
+        entry = RobEntry(instr, unit)
+        entry.srcs = [self.renameTable.lookup(reg) for reg in srcs] # read srcs before renaming dsts
+        entry.dsts = [self.renameTable.rename(reg) for reg in dsts]
+
+        if instr.name == "CVM":
+            self.maskClear = True
+        elif instr.name in vectorMaskRegOps:
+            self.maskClear = False
+
+        self.rob.append(entry)
+        self.rs[unit].push(entry)
+        self.dispatched(instr)
+        return True
+
+    # Backend Funcs
+    def isReady(self, entry):
+        return all(self.renameTable.ready[tag] for tag in entry.srcs)
+
+    def issue(self):
+        "each free unit takes the oldest ready instr from its reservation station"
+        for func in self.units:
+            if self.units[func].busy(): continue
+            entry = self.rs[func].select(self.isReady)
+            if entry:
+                self.units[func].inputVec(entry.instr.laneWork())
+                self.units[func].instr = entry
+                self.started(entry.instr)
+
+        entry = self.rs['VLS'].select(lambda entry: self.isReady(entry) and self.canStartMem(entry.instr))
+        if entry and self.startMem(entry.instr, entry):
+            self.writeback(entry) # store data was read into the store buffer
+
+        if self.s_remaining == 0:
+            entry = self.rs['SCALAR'].select(self.isReady)
+            if entry:
+                self.s_remaining = 1
+                self.s_instr = entry
+                self.started(entry.instr)
+
+    def writeback(self, entry):
+        entry.done = True
+        for new, _ in entry.dsts:
+            self.renameTable.ready[new] = True
+
+    def commit(self):
+        "retire the head of the ROB in order, and free the regs it overwrote"
+        if not self.rob or not self.rob[0].done: return
+        
+        entry = self.rob.pop(0)
+        for _, old in entry.dsts:
+            self.renameTable.release(old)
+
+    def drained(self):
+        return not self.rob and not self.vectorMemBusy()
+
+    def reachedHalt(self):
+        return self.halted
+
+    def stop(self):
+        return self.halted and self.drained()
+
+    def step(self):
+        "simulate one cycle"
+        self.cycle += 1
+
+        # backend
+        self.commit()
+        self.issue()
+
+        # update states here
+        self.s_remaining = max(self.s_remaining - 1, 0)
+        if self.s_instr and self.s_remaining == 0:
+            self.writeback(self.s_instr)
+            self.finished(self.s_instr.instr)
+            self.s_instr = None
+
+        self.drainStoreBuffer()
+        self.updateVectorMem()
+        for unit in self.vdataUnits:
+            if unit.instr and not unit.busy():
+                self.writeback(unit.instr)
+                self.finished(unit.instr.instr)
+                unit.instr = None
+
+        for func in self.units:
+            self.units[func].update()
+
+            if self.units[func].instr and not self.units[func].busy():
+                self.writeback(self.units[func].instr)
+                self.finished(self.units[func].instr.instr)
+                self.units[func].instr = None
+
+        # Frontend
+        # --------------
+        # decode stage, retries the same instr until it is dispatched
+        if self.instrBuf is not None:
+            if self.decode(self.instrBuf):
+                self.halted = isHalt(self.instrBuf)
+                self.instrBuf = None
+            else:
+                self.decodeStalls += 1
+
+        # fetch stage
+        if self.instrBuf is None and not self.halted:
+            self.instrBuf = self.fetch()
+
+    def printStats(self):
+        print(f"ROB depth: {self.robDepth}, Reservation stations:", {unit: rs.size for unit, rs in self.rs.items()})
+        print(f"Physical vector regs: {self.renameTable.numPhysVecRegs} (peak in use: {self.renameTable.peakVecInUse})")
+        print("Decode stall cycles:", self.stalls)
+
+# ---- Multi-Core ----
+# One timing sim per core, stepped in lockstep. The cores share the VDMEM banks,
+# so loads/stores of different cores contend for them, and they sync at BARRIER.
+
+class CoreBarrier:
+    """
+    A core arrives at BARRIER once the instrs before it are done, and all the
+    waiting cores go on when the last live core arrives. Cores that reached
+    HALT leave, so they don't hold up the rest.
+    """
+    def __init__(self, numCores):
+        self.live = numCores
+        self.waiting = set()
+        self.released = set() # released but haven't gone past their BARRIER yet
+        self.count = 0 # number of barriers passed
+
+    def arrive(self, core):
+        "returns True when core can go past its BARRIER"
+        if core in self.released:
+            self.released.remove(core)
+            return True
+
+        self.waiting.add(core)
+        if len(self.waiting) < self.live:
+            return False
+
+        self.release()
+        self.released.remove(core)
+        return True
+
+    def leave(self, core):
+        self.live -= 1
+        if self.waiting and len(self.waiting) >= self.live:
+            self.release()
+
+    def release(self):
+        self.released |= self.waiting
+        self.waiting = set()
+        self.count += 1
+
+class MultiCoreTimingSim:
+    def __init__(self, traces, config):
+        issueMode = config.parameters.get("issueMode", "inorder")
+        self.cores = [OoOTimingSim(trace, config) if issueMode == "ooo" else TimingSim(trace, config) for trace in traces]
+        self.banks = VDMBanks(int(config.parameters["vdmNumBanks"]), int(config.parameters["vdmBankBusyTime"]))
+        self.barrier = CoreBarrier(len(self.cores))
+
+        for core in self.cores:
+            core.shareBanks(self.banks)
+            core.barrier = self.barrier
+
+    def run(self):
+        self.cycle = 0
+        for core in self.cores:
+            core.cycle = 0
+        halted = set()
+
+        while not all(core.stop() for core in self.cores):
+            self.cycle += 1
+
+            # the core that steps first gets the banks first, it rotates every cycle
+            first = self.cycle % len(self.cores)
+            for core in self.cores[first:] + self.cores[:first]:
+                if not core.stop():
+                    core.step()
+            self.banks.update()
+
+            for idx, core in enumerate(self.cores):
+                if idx not in halted and core.reachedHalt():
+                    halted.add(idx)
+                    self.barrier.leave(core)
+
         return self.cycle
 
     def cyclesTaken(self):
         return self.cycle
 
+    def printStats(self):
+        print(f"Barriers: {self.barrier.count}")
+        for idx, core in enumerate(self.cores):
+            print(f"Core {idx}: {core.cyclesTaken()} cycles")
+            core.printVectorMemStats()
+            if isinstance(core, OoOTimingSim):
+                core.printStats()
+
+def report(ts, iodir):
+    "print the stats of a finished timing sim, and save the profile if there is one"
+    print(f"Cycles: {ts.cyclesTaken()}")
+    ts.printVectorMemStats()
+
+    if isinstance(ts, OoOTimingSim):
+        ts.printStats()
+
+    if ts.profiler:
+        ts.profiler.dump(iodir, ts.cyclesTaken())
+
 if __name__ == "__main__":
      #parse arguments for input file location
     parser = argparse.ArgumentParser(description='Vector Processor Timing Simulator')
     parser.add_argument('--iodir', default="", type=str, help='Path to the folder containing the input files - instructions and data.')
+    parser.add_argument('-p', '--profile', default=False, action='store_true', help="save per PC cycles as Code.annotated.asm and profile.folded")
     args = parser.parse_args()
 
     iodir = os.path.abspath(args.iodir)
@@ -483,8 +1164,12 @@ if __name__ == "__main__":
     print("Saved output of func simulator in out.txt")
 
     tracefp = os.path.abspath(os.path.join(iodir, "trace.asm"))
-    ts = TimingSim(tracefp, config)
+    issueMode = config.parameters.get("issueMode", "inorder")
+    ts = OoOTimingSim(tracefp, config) if issueMode == "ooo" else TimingSim(tracefp, config)
+
+    if args.profile:
+        ts.profiler = Profiler()
 
-    print("Running timing simulator...")
+    print(f"Running timing simulator ({issueMode} issue)...")
     ts.run()
-    print(f"Cycles: {ts.cyclesTaken()}")
+    report(ts, iodir)
\ No newline at end of file
@@ -23,29 +23,30 @@ allIntrs = {'ADDVS', 'ADD', 'SEQVV', 'SUBVV', 'AND', 'ADDVV', 'SLTVS', 'SVI',
             'CVM', 'SLEVV', 'PACKLO', 'SNEVS', 'UNPACKHI', 'SNEVV', 'POP', 'DIVVV', 
             'LVWS', 'SS', 'PACKHI', 'SLTVV', 'LVI', 'BNE', 'UNPACKLO', 'SUBVS', 
             'SRA', 'DIVVS', 'MULVV', 'SUB', 'BGE', 'XOR', 'SV', 'MULVS', 'SGTVV', 
-            'SGEVS', 'SGTVS', 'SGEVV', 'BLE', 'SVWS', 'SEQVS', 'MFCL', 'HALT'}
+            'SGEVS', 'SGTVS', 'SGEVV', 'BLE', 'SVWS', 'SEQVS', 'MFCL', 'HALT', 'BARRIER',
+            'MACW', 'MTEW', 'MFEW', 'SVN'}
 
 # number of operands each instruction has
 numOfOp = {
-            0: {'CVM', 'HALT'}, 
-            1: {'POP', 'MTCL', 'MFCL'},
+            0: {'CVM', 'HALT', 'BARRIER'}, 
+            1: {'POP', 'MTCL', 'MFCL', 'MTEW', 'MFEW'},
             2: {'SEQVV', 'SNEVV', 'SGTVV', 'SLTVV', 'SGEVV', 'SLEVV', 
                 'SEQVS', 'SNEVS', 'SGTVS', 'SLTVS', 'SGEVS', 'SLEVS',
-                'LV', 'SV'},
+                'LV', 'SV', 'SVN'},
             # 3 is rest
 }
 
 opCombos = {
-    ('v', 'v', 'v') : {'ADDVV', 'SUBVV', 'MULVV', 'DIVVV', 'UNPACKHI', 'UNPACKLO', 'PACKLO', 'PACKHI'},
+    ('v', 'v', 'v') : {'ADDVV', 'SUBVV', 'MULVV', 'DIVVV', 'UNPACKHI', 'UNPACKLO', 'PACKLO', 'PACKHI', 'MACW'},
     ('v', 'v', 's') : {'ADDVS', 'SUBVS', 'MULVS', 'DIVVS'},
     ('v', 'v', 'n') : {'SEQVV', 'SNEVV', 'SGTVV', 'SLTVV', 'SGEVV', 'SLEVV'},
-    ('v', 's', 'n') : {'SEQVS', 'SNEVS', 'SGTVS', 'SLTVS', 'SGEVS', 'SLEVS', 'LV', 'SV'},
-    ('s', 'n', 'n') : {'POP', 'MTCL', 'MFCL'},
+    ('v', 's', 'n') : {'SEQVS', 'SNEVS', 'SGTVS', 'SLTVS', 'SGEVS', 'SLEVS', 'LV', 'SV', 'SVN'},
+    ('s', 'n', 'n') : {'POP', 'MTCL', 'MFCL', 'MTEW', 'MFEW'},
     ('v', 's', 's') : {'LVWS', 'SVWS'},
     ('v', 's', 'v') : {'LVI', 'SVI'},
     ('s', 's', 'i') : {'LS', 'SS', 'BEQ', 'BNE', 'BGT', 'BLT', 'BGE', 'BLE'},
     ('s', 's', 's') : {'ADD', 'SUB', 'MUL', 'DIV', 'AND', 'OR', 'XOR', 'SLL', 'SRL', 'SRA'},
-    ('n', 'n', 'n') : {'CVM', 'HALT'}
+    ('n', 'n', 'n') : {'CVM', 'HALT', 'BARRIER'}
 }
 
 allVecInstrs = set()